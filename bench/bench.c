@@ -0,0 +1,410 @@
+#include "shim.h"
+#include "malloc.h"
+#include "arena.h"
+#include "ramdisk.h"
+#include "filesystem.h"
+#include "source.h"
+
+// Host benchmark suite
+// Replays synthetic workloads against the kernel's allocator and storage
+// stack and reports throughput and per-operation latency percentiles.
+//
+// Usage: karion-bench [-n ops] [-m memory_mb] [-d disk_mb] [-z 0|1] [suite...]
+
+#define BENCH_DEFAULT_OPS  100000
+#define BENCH_MAX_OPS      1000000
+#define BENCH_DISK_SIZE    (16u << 20)  // Ramdisk size unless -d is given
+#define BENCH_SLOTS        1024         // Live allocations in the allocation trace
+#define BENCH_FILES        64           // Files touched by the fs mix
+#define BENCH_DEPTH        8            // Directory depth for path lookups
+
+// Benchmark description
+typedef struct {
+    const char* name;           // Suite name (used on the command line)
+    const char* description;    // One-line summary
+    void (*setup)(void);        // Run once before timing (can be NULL)
+    void (*op)(unsigned int i); // One timed operation
+} bench_t;
+
+// Per-operation latencies of the current suite
+static unsigned long long samples[BENCH_MAX_OPS];
+
+// Deterministic workload generator (xorshift32)
+static unsigned int rng_state = 2463534242u;
+
+/**
+ * Get the next pseudo-random number
+ *
+ * @return: Random 32-bit value
+ */
+static unsigned int rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/**
+ * Draw an allocation size from a small/medium/large mix
+ * Roughly 70% slab-sized, 25% heap blocks and 5% large buffers
+ *
+ * @return: Size in bytes
+ */
+static unsigned int alloc_size(void)
+{
+    unsigned int pick = rng() % 100;
+    if (pick < 70) {
+        return 16 + rng() % 241;
+    }
+    if (pick < 95) {
+        return 257 + rng() % 3840;
+    }
+    return 4096 + rng() % (60 * 1024);
+}
+
+// ----------------------------------------------------------------------------
+// Allocator workloads
+// ----------------------------------------------------------------------------
+
+static void* slots[BENCH_SLOTS];
+static unsigned int slot_sizes[BENCH_SLOTS];
+
+// Allocation trace: each op frees a random live slot or fills an empty one
+static void op_alloc(unsigned int i)
+{
+    unsigned int slot = rng() % BENCH_SLOTS;
+    (void)i;
+
+    if (slots[slot] != NULL) {
+        kfree(slots[slot]);
+        slots[slot] = NULL;
+    } else {
+        slots[slot] = kmalloc(alloc_size());
+    }
+}
+
+// Growing buffers: append to a random buffer, restart it once it gets large
+static void op_realloc(unsigned int i)
+{
+    unsigned int slot = rng() % BENCH_SLOTS;
+    (void)i;
+
+    if (slot_sizes[slot] >= 16 * 1024) {
+        kfree(slots[slot]);
+        slots[slot] = NULL;
+        slot_sizes[slot] = 0;
+        return;
+    }
+
+    unsigned int size = slot_sizes[slot] + 16 + rng() % 497;
+    void* ptr = krealloc(slots[slot], size);
+    if (ptr != NULL) {
+        slots[slot] = ptr;
+        slot_sizes[slot] = size;
+    }
+}
+
+// Scratch temporaries: a few arena allocations per simulated command
+static void op_arena(unsigned int i)
+{
+    arena_alloc(&scratch_arena, alloc_size());
+    if (i % 8 == 7) {
+        arena_reset(&scratch_arena);
+    }
+}
+
+/**
+ * Release everything the allocator workloads left behind
+ */
+static void slots_clear(void)
+{
+    for (int i = 0; i < BENCH_SLOTS; i++) {
+        kfree(slots[i]);
+        slots[i] = NULL;
+        slot_sizes[i] = 0;
+    }
+    arena_reset(&scratch_arena);
+}
+
+// ----------------------------------------------------------------------------
+// File system workloads
+// ----------------------------------------------------------------------------
+
+static char file_names[BENCH_FILES][32];
+static int file_exists[BENCH_FILES];
+static char file_content[2048];
+static char deep_file[BENCH_DEPTH * 4 + 16];
+
+/**
+ * Build the shared file content and the names of the mix files
+ */
+static void fs_mix_setup(void)
+{
+    char num[12];
+
+    for (int i = 0; i < (int)sizeof(file_content) - 1; i++) {
+        file_content[i] = 'a' + i % 26;
+    }
+    file_content[sizeof(file_content) - 1] = '\0';
+
+    fs_create_directory("/mix");
+    for (int i = 0; i < BENCH_FILES; i++) {
+        strcpy(file_names[i], "/mix/f");
+        strcat(file_names[i], utoa(i, num, 10));
+        if (file_exists[i]) {
+            fs_delete_file(file_names[i]);
+        }
+        file_exists[i] = 0;
+    }
+}
+
+/**
+ * Pick a content length and terminate the shared content there
+ *
+ * @param length: Pointer to store the chosen length
+ * @return: Character that was overwritten (restore it after the write)
+ */
+static int content_cut(unsigned int* length)
+{
+    *length = 64 + rng() % 1400;
+    int saved = file_content[*length];
+    file_content[*length] = '\0';
+    return saved;
+}
+
+// Create/write/read/delete mix over a fixed set of files
+static void op_fs_mix(unsigned int i)
+{
+    unsigned int file = rng() % BENCH_FILES;
+    unsigned int pick = rng() % 10;
+    unsigned int length;
+    (void)i;
+
+    if (!file_exists[file]) {
+        int saved = content_cut(&length);
+        file_exists[file] = fs_create_file(file_names[file], file_content);
+        file_content[length] = saved;
+    } else if (pick < 4) {
+        int saved = content_cut(&length);
+        fs_write_file(file_names[file], file_content);
+        file_content[length] = saved;
+    } else if (pick < 8) {
+        fs_read_file(file_names[file]);
+    } else {
+        fs_delete_file(file_names[file]);
+        file_exists[file] = 0;
+    }
+
+    // The shell releases per-command memory after every command
+    arena_reset(&scratch_arena);
+}
+
+/**
+ * Create a directory chain BENCH_DEPTH levels deep with a file at the bottom
+ */
+static void lookup_setup(void)
+{
+    char num[12];
+
+    deep_file[0] = '\0';
+    for (int i = 0; i < BENCH_DEPTH; i++) {
+        strcat(deep_file, "/d");
+        strcat(deep_file, utoa(i, num, 10));
+        fs_create_directory(deep_file);
+    }
+    strcat(deep_file, "/leaf");
+    fs_create_file(deep_file, "leaf");
+}
+
+// Deep path lookup: read a small file at the bottom of the chain
+static void op_lookup(unsigned int i)
+{
+    (void)i;
+    fs_read_file(deep_file);
+    arena_reset(&scratch_arena);
+}
+
+static bench_t benches[] = {
+    { "alloc",   "kmalloc/kfree trace over a live set",       NULL,          op_alloc   },
+    { "realloc", "krealloc appends to growing buffers",       NULL,          op_realloc },
+    { "arena",   "scratch arena allocations with reset",      NULL,          op_arena   },
+    { "fs-mix",  "create/write/read/delete mix",              fs_mix_setup,  op_fs_mix  },
+    { "lookup",  "read at the end of a deep directory chain", lookup_setup,  op_lookup  },
+};
+
+#define BENCH_COUNT ((int)(sizeof(benches) / sizeof(benches[0])))
+
+// ----------------------------------------------------------------------------
+// Runner
+// ----------------------------------------------------------------------------
+
+/**
+ * Sort latency samples in place (heapsort: no recursion, no extra memory)
+ *
+ * @param a: Samples
+ * @param n: Number of samples
+ */
+static void sort_samples(unsigned long long* a, unsigned int n)
+{
+    for (unsigned int start = n / 2; start-- > 0; ) {
+        unsigned int root = start;
+        while (2 * root + 1 < n) {
+            unsigned int child = 2 * root + 1;
+            if (child + 1 < n && a[child] < a[child + 1]) child++;
+            if (a[root] >= a[child]) break;
+            unsigned long long t = a[root]; a[root] = a[child]; a[child] = t;
+            root = child;
+        }
+    }
+
+    for (unsigned int end = n; end-- > 1; ) {
+        unsigned long long t = a[0]; a[0] = a[end]; a[end] = t;
+        unsigned int root = 0;
+        while (2 * root + 1 < end) {
+            unsigned int child = 2 * root + 1;
+            if (child + 1 < end && a[child] < a[child + 1]) child++;
+            if (a[root] >= a[child]) break;
+            t = a[root]; a[root] = a[child]; a[child] = t;
+            root = child;
+        }
+    }
+}
+
+/**
+ * Get a percentile from sorted samples
+ *
+ * @param sorted: Sorted samples
+ * @param n: Number of samples
+ * @param pct: Percentile (0-100)
+ * @return: Sample value at that percentile
+ */
+static unsigned long long percentile(unsigned long long* sorted, unsigned int n, unsigned int pct)
+{
+    unsigned int index = (unsigned int)((unsigned long long)(n - 1) * pct / 100);
+    return sorted[index];
+}
+
+/**
+ * Run one suite and print its results
+ *
+ * @param bench: Suite to run
+ * @param ops: Number of timed operations
+ */
+static void run_bench(bench_t* bench, unsigned int ops)
+{
+    if (bench->setup) {
+        bench->setup();
+    }
+
+    unsigned long long start = shim_clock_ns();
+    for (unsigned int i = 0; i < ops; i++) {
+        unsigned long long t0 = shim_clock_ns();
+        bench->op(i);
+        samples[i] = shim_clock_ns() - t0;
+    }
+    unsigned long long elapsed = shim_clock_ns() - start;
+
+    sort_samples(samples, ops);
+    unsigned long long ops_per_sec = elapsed ? (unsigned long long)ops * 1000000000ull / elapsed : 0;
+
+    shim_print("%-8s %9u %11llu %9llu %9llu %9llu %10llu   %s\n",
+               bench->name, ops, ops_per_sec,
+               percentile(samples, ops, 50), percentile(samples, ops, 90),
+               percentile(samples, ops, 99), samples[ops - 1],
+               bench->description);
+
+    slots_clear();
+}
+
+/**
+ * Check whether a suite was selected on the command line
+ *
+ * @param name: Suite name
+ * @param argc: Argument count
+ * @param argv: Arguments
+ * @param first: Index of the first suite argument
+ * @return: 1 if selected (or no suites were named), 0 otherwise
+ */
+static int selected(const char* name, int argc, char** argv, int first)
+{
+    if (first >= argc) {
+        return 1;
+    }
+    for (int i = first; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long ops = BENCH_DEFAULT_OPS;
+    unsigned long memory = SHIM_DEFAULT_MEMORY;
+    unsigned long disk = BENCH_DISK_SIZE;
+    unsigned long compress = 0;
+
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-n") == 0) {
+            ops = shim_atoul(argv[arg + 1]);
+        } else if (strcmp(argv[arg], "-m") == 0) {
+            memory = shim_atoul(argv[arg + 1]) << 20;
+        } else if (strcmp(argv[arg], "-d") == 0) {
+            disk = shim_atoul(argv[arg + 1]) << 20;
+        } else if (strcmp(argv[arg], "-z") == 0) {
+            compress = shim_atoul(argv[arg + 1]);
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+
+    if (ops == 0 || ops > BENCH_MAX_OPS || memory == 0 || disk > 0xFFFFFFFFul) {
+        shim_print("usage: %s [-n ops] [-m memory_mb] [-d disk_mb] [-z 0|1] [suite...]\n", argv[0]);
+        shim_print("  -n: 1..%u operations per suite\n", BENCH_MAX_OPS);
+        shim_print("  -z: 1 for a compressed ramdisk\n");
+        for (int i = 0; i < BENCH_COUNT; i++) {
+            shim_print("  %-8s %s\n", benches[i].name, benches[i].description);
+        }
+        return 1;
+    }
+
+    if (shim_init(memory) != 0) {
+        shim_print("%s: cannot set up %lu bytes of memory\n", argv[0], memory);
+        return 1;
+    }
+
+    // Same bring-up order as the kernel
+    ramdisk_set_size(disk);
+    ramdisk_set_compression(compress != 0);
+    heap_init();
+    filesystem_init();
+
+    unsigned int disk_size, disk_blocks;
+    ramdisk_get_info(&disk_size, &disk_blocks);
+    shim_print("memory %lu MB, disk %u KB (%u blocks%s), %lu ops per suite\n\n",
+               memory >> 20, disk_size >> 10, disk_blocks,
+               ramdisk_get_compress_stats(0, NULL) == 0 ? ", compressed" : "", ops);
+    shim_print("%-8s %9s %11s %9s %9s %9s %10s\n",
+               "suite", "ops", "ops/sec", "p50(ns)", "p90(ns)", "p99(ns)", "max(ns)");
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        if (selected(benches[i].name, argc, argv, arg)) {
+            run_bench(&benches[i], (unsigned int)ops);
+        }
+    }
+
+    ramdisk_compress_stats_t zs;
+    if (ramdisk_get_compress_stats(0, &zs) == 0) {
+        shim_print("\ncompressed: %u blocks in %u bytes, %u raw, %u packs avg %llu cycles, %u unpacks avg %llu cycles, hot %u/%u\n",
+                   zs.stored_blocks, zs.stored_bytes, zs.raw_blocks,
+                   zs.compressions, zs.compressions ? zs.compress_cycles / zs.compressions : 0,
+                   zs.decompressions, zs.decompressions ? zs.decompress_cycles / zs.decompressions : 0,
+                   zs.hot_hits, zs.hot_misses);
+    }
+
+    return 0;
+}
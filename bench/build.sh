@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# Karion-OS host benchmark build script
+# Compiles the allocator and storage stack into a Linux executable
+# linked against the shim in bench/shim.c instead of real hardware.
+# Run from the repository root: ./bench/build.sh && ./buildartifacts/bench/karion-bench
+
+echo "Building Karion-OS host benchmark..."
+
+if ! [ -x "$(which gcc)" ]; then
+  echo "Error: gcc is not installed." >&2
+  exit 1
+fi
+
+# Create build artifacts directory
+mkdir -p buildartifacts/bench
+
+# Kernel sources under test (freestanding, so the kernel's string functions are used)
+KERNEL_SOURCES="source malloc pmm arena pci ata virtio lz ramdisk block buffer inode filesystem"
+for name in $KERNEL_SOURCES; do
+  gcc -O2 -g -c src/$name.c -o buildartifacts/bench/$name.o -ffreestanding -fno-builtin -fno-stack-protector -Wall -Wextra -I include || exit 1
+done
+
+# Benchmark and shim
+gcc -O2 -g -c bench/bench.c -o buildartifacts/bench/bench.o -ffreestanding -fno-builtin -Wall -Wextra -I include -I bench || exit 1
+gcc -O2 -g -c bench/shim.c -o buildartifacts/bench/shim.o -Wall -Wextra -I bench || exit 1
+
+# Link everything together
+OBJECTS="buildartifacts/bench/bench.o buildartifacts/bench/shim.o"
+for name in $KERNEL_SOURCES; do
+  OBJECTS="$OBJECTS buildartifacts/bench/$name.o"
+done
+gcc -o buildartifacts/bench/karion-bench $OBJECTS || exit 1
+
+echo "Done. Run: buildartifacts/bench/karion-bench [-n ops] [suite...]"
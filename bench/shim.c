@@ -0,0 +1,183 @@
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "shim.h"
+
+// Kernel symbols used here (kernel headers clash with libc's)
+extern unsigned short* terminal_buffer;
+int pmm_init_range(unsigned long start, unsigned long end);
+
+// Off-screen VGA text buffer (clear_screen walks 2 * 80 * 25 entries)
+static unsigned short vga_buffer[80 * 25 * 2];
+
+/**
+ * Set up the simulated machine
+ *
+ * @param memory: Bytes of simulated physical memory
+ * @return: 0 on success, -1 on error
+ */
+int shim_init(unsigned long memory)
+{
+    terminal_buffer = vga_buffer;
+
+    void* base = mmap(NULL, memory, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    return pmm_init_range((unsigned long)base, (unsigned long)base + memory);
+}
+
+/**
+ * Read a monotonic clock
+ *
+ * @return: Time in nanoseconds
+ */
+unsigned long long shim_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * Print formatted text to standard output
+ *
+ * @param format: printf format string
+ */
+void shim_print(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/**
+ * Parse a decimal number
+ *
+ * @param str: String to parse
+ * @return: Value, or 0 if str is not a number
+ */
+unsigned long shim_atoul(const char* str)
+{
+    return strtoul(str, NULL, 10);
+}
+
+/**
+ * Read a byte from an I/O port
+ * No devices are attached, so reads see a floating bus
+ *
+ * @param port: Port number
+ * @return: 0xFF
+ */
+unsigned char inb(unsigned short port)
+{
+    (void)port;
+    return 0xFF;
+}
+
+/**
+ * Write a byte to an I/O port (ignored)
+ *
+ * @param port: Port number
+ * @param value: Byte to write
+ */
+void outb(unsigned short port, unsigned char value)
+{
+    (void)port;
+    (void)value;
+}
+
+/**
+ * Read a 16-bit word from an I/O port (floating bus)
+ *
+ * @param port: Port number
+ * @return: 0xFFFF
+ */
+unsigned short inw(unsigned short port)
+{
+    (void)port;
+    return 0xFFFF;
+}
+
+/**
+ * Write a 16-bit word to an I/O port (ignored)
+ *
+ * @param port: Port number
+ * @param value: Word to write
+ */
+void outw(unsigned short port, unsigned short value)
+{
+    (void)port;
+    (void)value;
+}
+
+/**
+ * Read a 32-bit value from an I/O port (floating bus)
+ *
+ * @param port: Port number
+ * @return: 0xFFFFFFFF
+ */
+unsigned int inl(unsigned short port)
+{
+    (void)port;
+    return 0xFFFFFFFFu;
+}
+
+/**
+ * Write a 32-bit value to an I/O port (ignored)
+ *
+ * @param port: Port number
+ * @param value: Value to write
+ */
+void outl(unsigned short port, unsigned int value)
+{
+    (void)port;
+    (void)value;
+}
+
+/**
+ * Read a run of 16-bit words from an I/O port (floating bus)
+ *
+ * @param port: Port number
+ * @param buffer: Destination (count words)
+ * @param count: Number of words
+ */
+void insw(unsigned short port, void* buffer, unsigned int count)
+{
+    (void)port;
+    memset(buffer, 0xFF, (size_t)count * 2);
+}
+
+/**
+ * Write a run of 16-bit words to an I/O port (ignored)
+ *
+ * @param port: Port number
+ * @param buffer: Source (count words)
+ * @param count: Number of words
+ */
+void outsw(unsigned short port, const void* buffer, unsigned int count)
+{
+    (void)port;
+    (void)buffer;
+    (void)count;
+}
+
+/**
+ * Read the CPU timestamp counter (the host has one too)
+ *
+ * @return: Cycles since reset
+ */
+unsigned long long rdtsc(void)
+{
+    unsigned int lo, hi;
+    __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
@@ -0,0 +1,35 @@
+#ifndef SHIM_DOT_H
+#define SHIM_DOT_H
+
+// Host shim for running kernel code as a Linux program
+// Stands in for the hardware the kernel expects: physical memory,
+// the VGA text buffer and port I/O. Kept free of libc headers so it
+// can be included next to the kernel's own headers.
+
+#define SHIM_DEFAULT_MEMORY (256u << 20)  // Simulated physical memory in bytes
+
+// Set up the simulated machine
+// Maps host memory for the page-frame allocator and points VGA output
+// at an off-screen buffer
+//
+// @param memory: Bytes of simulated physical memory
+// @return: 0 on success, -1 on error
+int shim_init(unsigned long memory);
+
+// Read a monotonic clock
+//
+// @return: Time in nanoseconds
+unsigned long long shim_clock_ns(void);
+
+// Print formatted text to standard output (printf format)
+//
+// @param format: Format string
+void shim_print(const char* format, ...);
+
+// Parse a decimal number
+//
+// @param str: String to parse
+// @return: Value, or 0 if str is not a number
+unsigned long shim_atoul(const char* str);
+
+#endif /* SHIM_DOT_H */
@@ -27,19 +27,26 @@ mkdir -p buildartifacts
 gcc -m32 -c src/kernel.c -o buildartifacts/kernel.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/source.c -o buildartifacts/source.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/keyboard.c -o buildartifacts/keyboard.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/io.c -o buildartifacts/io.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/shell.c -o buildartifacts/shell.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/filesystem.c -o buildartifacts/filesystem.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/malloc.c -o buildartifacts/malloc.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/pmm.c -o buildartifacts/pmm.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/arena.c -o buildartifacts/arena.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/lz.c -o buildartifacts/lz.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/ramdisk.c -o buildartifacts/ramdisk.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/block.c -o buildartifacts/block.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/buffer.c -o buildartifacts/buffer.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 gcc -m32 -c src/inode.c -o buildartifacts/inode.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/pci.c -o buildartifacts/pci.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/ata.c -o buildartifacts/ata.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
+gcc -m32 -c src/virtio.c -o buildartifacts/virtio.o -ffreestanding -fno-stack-protector -nostdlib -Wall -Wextra -I include
 
 # Compile the assembly files using NASM
 nasm -f elf32 src/boot.asm -o buildartifacts/boot.o
 
 # Link everything together
-ld -m elf_i386 -T src/linker.ld -o buildartifacts/kernel.bin buildartifacts/boot.o buildartifacts/kernel.o buildartifacts/source.o buildartifacts/keyboard.o buildartifacts/shell.o buildartifacts/filesystem.o buildartifacts/malloc.o buildartifacts/ramdisk.o buildartifacts/block.o buildartifacts/buffer.o buildartifacts/inode.o
+ld -m elf_i386 -T src/linker.ld -o buildartifacts/kernel.bin buildartifacts/boot.o buildartifacts/kernel.o buildartifacts/source.o buildartifacts/keyboard.o buildartifacts/io.o buildartifacts/shell.o buildartifacts/filesystem.o buildartifacts/malloc.o buildartifacts/pmm.o buildartifacts/arena.o buildartifacts/lz.o buildartifacts/ramdisk.o buildartifacts/block.o buildartifacts/buffer.o buildartifacts/inode.o buildartifacts/pci.o buildartifacts/ata.o buildartifacts/virtio.o
 
 # Create ISO if GRUB is available
 if [ -x "$(which grub-mkrescue)" ]; then
@@ -0,0 +1,41 @@
+#ifndef ARENA_DOT_H
+#define ARENA_DOT_H
+
+// Bump-pointer arena allocator
+// Hands out memory by advancing a pointer and frees everything at once.
+// Used for short-lived temporaries that only live for one shell command.
+
+#define ARENA_BLOCK_SIZE  (64 * 1024)  // Size of each block taken from the heap
+#define ARENA_ALIGN       8            // Alignment of every allocation
+
+// Arena memory block
+typedef struct arena_block {
+    struct arena_block* next;  // Next block (older blocks first)
+    unsigned int size;         // Bytes available after the header
+    unsigned int used;         // Bytes handed out so far
+} arena_block_t;
+
+// Arena structure
+typedef struct {
+    arena_block_t* first;      // Block kept across resets
+    arena_block_t* current;    // Block currently being filled
+} arena_t;
+
+// Per-command scratch arena (reset by the shell after every command)
+extern arena_t scratch_arena;
+
+// Allocate memory from an arena
+// The memory stays valid until the next arena_reset
+//
+// @param arena: Arena to allocate from
+// @param size: Number of bytes to allocate
+// @return: Pointer to memory, or NULL if out of memory
+void* arena_alloc(arena_t* arena, unsigned int size);
+
+// Release everything allocated from an arena
+// Keeps the first block so the next use costs no heap allocation
+//
+// @param arena: Arena to reset
+void arena_reset(arena_t* arena);
+
+#endif /* ARENA_DOT_H */
@@ -0,0 +1,96 @@
+#ifndef ATA_DOT_H
+#define ATA_DOT_H
+
+#include "pci.h"
+#include "block.h"
+
+// ATA/IDE disk driver
+// Drives the legacy IDE channels with LBA28 commands. Transfers use
+// bus-master DMA when the IDE controller on the PCI bus provides it and
+// fall back to PIO otherwise. There is no interrupt support yet, so
+// every command is polled to completion (nIEN is set on each channel).
+
+// Legacy channel ports
+#define ATA_PRIMARY_IO        0x1F0
+#define ATA_PRIMARY_CTRL      0x3F6
+#define ATA_SECONDARY_IO      0x170
+#define ATA_SECONDARY_CTRL    0x376
+
+// Task file registers (offsets from the I/O base)
+#define ATA_REG_DATA          0
+#define ATA_REG_ERROR         1
+#define ATA_REG_SECCOUNT      2
+#define ATA_REG_LBA_LO        3
+#define ATA_REG_LBA_MID       4
+#define ATA_REG_LBA_HI        5
+#define ATA_REG_DRIVE         6
+#define ATA_REG_STATUS        7  // Read
+#define ATA_REG_COMMAND       7  // Write
+
+// Control register bits
+#define ATA_CTRL_NIEN         0x02  // Mask the device interrupt
+
+// Status register bits
+#define ATA_SR_ERR            0x01
+#define ATA_SR_DRQ            0x08
+#define ATA_SR_DF             0x20
+#define ATA_SR_BSY            0x80
+
+// Commands
+#define ATA_CMD_READ_PIO      0x20
+#define ATA_CMD_WRITE_PIO     0x30
+#define ATA_CMD_READ_DMA      0xC8
+#define ATA_CMD_WRITE_DMA     0xCA
+#define ATA_CMD_CACHE_FLUSH   0xE7
+#define ATA_CMD_IDENTIFY      0xEC
+
+// Bus-master IDE registers (offsets from the channel's bus-master base)
+#define ATA_BM_COMMAND        0
+#define ATA_BM_STATUS         2
+#define ATA_BM_PRDT           4
+#define ATA_BM_CMD_START      0x01
+#define ATA_BM_CMD_READ       0x08  // Device to memory
+#define ATA_BM_SR_ACTIVE      0x01
+#define ATA_BM_SR_ERR         0x02
+#define ATA_BM_SR_IRQ         0x04
+
+#define ATA_MAX_DRIVES        4        // Master and slave on two channels
+#define ATA_MAX_SECTORS       256      // Sectors per LBA28 command
+#define ATA_LBA28_LIMIT       0x0FFFFFFF
+#define ATA_PRD_ENTRIES       4        // Enough for 128 KiB crossing 64 KiB boundaries
+#define ATA_PRD_BOUNDARY      0x10000  // A PRD region must not cross 64 KiB
+#define ATA_PRD_EOT           0x8000   // Last entry in the table
+#define ATA_TIMEOUT           10000000 // Status polls before giving up
+
+// Physical region descriptor (bus-master scatter/gather entry)
+typedef struct {
+    unsigned int address;      // Physical address of the region
+    unsigned short size;       // Byte count (0 means 64 KiB)
+    unsigned short flags;      // ATA_PRD_EOT on the last entry
+} __attribute__((packed)) ata_prd_t;
+
+// IDE channel
+typedef struct {
+    unsigned short io;         // Task file base
+    unsigned short ctrl;       // Control / alternate status
+    unsigned short bmide;      // Bus-master base (0 = PIO only)
+    ata_prd_t* prdt;           // Descriptor table for DMA
+} ata_channel_t;
+
+// ATA drive
+typedef struct {
+    ata_channel_t* channel;    // Channel the drive sits on
+    unsigned char slave;       // 0 = master, 1 = slave
+    unsigned char dma;         // Drive supports DMA and it has not failed
+    unsigned int sectors;      // Capacity in 512-byte sectors
+    int device;                // Block device number
+} ata_drive_t;
+
+// Initialize ATA disks
+// Finds the IDE controller, probes both channels and registers every
+// ATA disk found as a block device
+//
+// @return: Number of disks registered
+int ata_init(void);
+
+#endif /* ATA_DOT_H */
@@ -1,27 +1,173 @@
 #ifndef BLOCK_DOT_H
 #define BLOCK_DOT_H
 
-#include "ramdisk.h"
-
 // Block device abstraction layer
-// Provides a unified interface for block-based storage
+// Provides a unified interface for block-based storage.
+// Drivers register numbered devices with an operations table; the
+// block_* calls below act on the root device (the one holding the
+// file system) and dispatch straight through its table.
 
-#define BLOCK_DEVICE_RAMDISK 0
+#define BLOCK_SIZE         512  // Standard disk sector size
+#define BLOCK_MAX_DEVICES  8    // Registered devices at most
+#define BLOCK_QUEUE_DEPTH  64   // Pending requests before submit dispatches
+#define BLOCK_MERGE_MAX    32   // Requests merged into one transfer at most
+#define BLOCK_HIST_BUCKETS 20   // Latency histogram buckets (powers of two)
+#define BLOCK_HIST_SHIFT   8    // Bucket 0 holds latencies below 2^(SHIFT+1) cycles
 
-// Block device structure
+// Request states
+#define BLOCK_REQ_IDLE     0    // Never submitted
+#define BLOCK_REQ_PENDING  1    // Queued, not yet dispatched
+#define BLOCK_REQ_DONE     2    // Completed successfully
+#define BLOCK_REQ_ERROR    3    // Completed with an error
+
+struct block_device;
+
+// One segment of a vectored transfer
+typedef struct {
+    unsigned char* buffer;     // Memory for this segment
+    unsigned int count;        // Blocks in this segment
+} block_segment_t;
+
+// Driver operations
+// Block ranges are checked against the device size before a call.
+// Optional entries may be NULL.
+typedef struct {
+    const char* name;          // Driver name (e.g. "ramdisk")
+    int persistent;            // Contents survive power-off (a disk, not RAM)
+
+    // Transfer `count` consecutive blocks starting at start_block
+    int (*read)(struct block_device* dev, unsigned int start_block, unsigned int count, unsigned char* buffer);
+    int (*write)(struct block_device* dev, unsigned int start_block, unsigned int count, unsigned char* buffer);
+
+    // Transfer consecutive blocks scattered over several buffers (optional)
+    int (*readv)(struct block_device* dev, unsigned int start_block, block_segment_t* segments, unsigned int nsegments);
+    int (*writev)(struct block_device* dev, unsigned int start_block, block_segment_t* segments, unsigned int nsegments);
+
+    // Make completed writes durable (optional)
+    int (*flush)(struct block_device* dev);
+
+    // Drop the contents of a range of blocks (optional)
+    int (*discard)(struct block_device* dev, unsigned int start_block, unsigned int count);
+
+    // Direct pointer to a block's storage, or NULL (optional)
+    // `write` is non-zero when the caller is about to overwrite the block
+    unsigned char* (*map)(struct block_device* dev, unsigned int block_num, int write);
+    void (*unmap)(struct block_device* dev, unsigned int block_num);
+} block_driver_t;
+
+// One block of a vectored transfer
 typedef struct {
-    int type;              // Device type (RAMDISK, etc.)
-    int initialized;       // Initialization flag
-    unsigned int block_size;  // Size of each block
-    unsigned int total_blocks; // Total number of blocks
+    unsigned int block;        // Block number
+    unsigned char* buffer;     // BLOCK_SIZE bytes of memory for it
+} block_vec_t;
+
+// Asynchronous block request
+// Owned by the caller, which must keep it (and its buffer) alive until
+// the request completes
+typedef struct block_request {
+    unsigned int block;             // First block
+    unsigned int count;             // Number of blocks
+    unsigned char* buffer;          // Data (count * BLOCK_SIZE bytes)
+    int write;                      // Non-zero to write, zero to read
+    int status;                     // BLOCK_REQ_*
+    struct block_request* next;     // Next request in the queue
+} block_request_t;
+
+// Statistics for one direction of transfers
+typedef struct {
+    unsigned int ops;               // Driver calls
+    unsigned int blocks;            // Blocks transferred
+    unsigned int errors;            // Calls that failed
+    unsigned long long cycles;      // Total latency (timestamp counter)
+    unsigned int max_cycles;        // Slowest call (saturates)
+    unsigned int histogram[BLOCK_HIST_BUCKETS];  // Bucket b: latency < 2^(b+SHIFT+1)
+} block_io_stats_t;
+
+// Per-device I/O statistics
+typedef struct {
+    block_io_stats_t read;
+    block_io_stats_t write;
+    unsigned int merges;            // Requests or blocks folded into another's driver call
+    unsigned int maps;              // Blocks accessed through block_map
+    unsigned int flushes;
+    unsigned int discards;
+} block_stats_t;
+
+// Block device structure
+typedef struct block_device {
+    int id;                         // Device number in the registry
+    const block_driver_t* driver;   // Operations
+    void* driver_data;              // Driver's per-device state
+    unsigned int block_size;        // Size of each block
+    unsigned int total_blocks;      // Total number of blocks
+    block_stats_t stats;            // I/O counters since registration or reset
 } block_device_t;
 
+// Register a block device
+// Called by drivers once a device is ready for I/O
+//
+// @param driver: Operations for the device (must stay valid)
+// @param driver_data: Driver's per-device state
+// @param total_blocks: Device size in blocks
+// @return: Device number, or -1 if the registry is full
+int block_register(const block_driver_t* driver, void* driver_data, unsigned int total_blocks);
+
+// Look up a registered device
+// Hot paths can keep the pointer and call dev->driver directly
+//
+// @param id: Device number
+// @return: Device, or NULL if no such device
+block_device_t* block_get_device(int id);
+
+// Get the number of registered devices
+//
+// @return: Device count (devices are numbered 0..count-1)
+int block_device_count(void);
+
+// Zero the I/O statistics of every device
+void block_reset_stats(void);
+
 // Initialize block device
-// Sets up the underlying storage (RAM disk)
+// Sets up the underlying storage (virtio or ATA disk, else RAM disk) and selects
+// the root device
 //
 // @return: 0 on success, -1 on error
 int block_device_init(void);
 
+// Fill in a request
+//
+// @param req: Request to fill in
+// @param write: Non-zero to write, zero to read
+// @param block: First block
+// @param count: Number of blocks
+// @param buffer: Data (count * BLOCK_SIZE bytes)
+void block_request_init(block_request_t* req, int write, unsigned int block, unsigned int count, unsigned char* buffer);
+
+// Queue a request on the root device
+// Requests wait in an elevator sorted by block number until the queue is
+// polled; a request overlapping a queued one with a write on either side
+// dispatches the queue first, so overlapping requests keep their order.
+// The synchronous calls below also drain the queue before they run.
+//
+// @param req: Request (must not already be pending)
+// @return: 0 if queued, -1 on an invalid request
+int block_submit(block_request_t* req);
+
+// Dispatch queued requests
+// Sweeps the queue in block order from the last dispatched position,
+// merging adjacent requests in the same direction into one transfer.
+// Drivers complete synchronously, so every dispatched request is done
+// when this returns.
+//
+// @return: Number of requests completed
+int block_poll(void);
+
+// Wait for a request to complete
+//
+// @param req: Submitted request
+// @return: 0 on success, -1 if the request failed
+int block_wait(block_request_t* req);
+
 // Read a block from the block device
 //
 // @param block_num: Block number to read
@@ -52,6 +198,58 @@ int block_read_multiple(unsigned int start_block, unsigned int count, unsigned c
 // @return: 0 on success, -1 on error
 int block_write_multiple(unsigned int start_block, unsigned int count, unsigned char* buffer);
 
+// Read a list of blocks (scatter-gather)
+// Entries with consecutive block numbers form a run that reaches the
+// driver as one call: a single read when the buffers are contiguous,
+// the driver's readv otherwise (or one read per contiguous piece)
+//
+// @param vec: Blocks and their buffers
+// @param count: Number of entries
+// @return: 0 on success, -1 on error
+int block_readv(block_vec_t* vec, unsigned int count);
+
+// Write a list of blocks (scatter-gather)
+// Runs are formed as for block_readv
+//
+// @param vec: Blocks and their buffers
+// @param count: Number of entries
+// @return: 0 on success, -1 on error
+int block_writev(block_vec_t* vec, unsigned int count);
+
+// Flush completed writes to stable storage
+//
+// @return: 0 on success, -1 on error
+int block_flush(void);
+
+// Discard a range of blocks
+// Tells the device the contents are no longer needed; discarded
+// blocks read as zeros until they are written again
+//
+// @param start_block: First block to discard
+// @param count: Number of blocks
+// @return: 0 on success, -1 on error
+int block_discard(unsigned int start_block, unsigned int count);
+
+// Map a block for direct access
+// Devices whose storage is addressable memory (the RAM disk) return a
+// pointer into it, so callers can skip the copy through a buffer.
+// Writes through the pointer reach the device immediately.
+// A block that holds no data yet (and reads as zeros) is only mapped for
+// a caller about to overwrite it; otherwise the map fails and the block
+// is read the usual way.
+// Every successful map must be paired with block_unmap.
+//
+// @param block_num: Block number to map
+// @param write: Non-zero if the caller will overwrite the whole block
+// @param ptr: Pointer to store the block's address
+// @return: 0 on success, -1 if the block cannot be mapped (use block_read/block_write)
+int block_map(unsigned int block_num, int write, unsigned char** ptr);
+
+// Release a block mapped with block_map
+//
+// @param block_num: Block number that was mapped
+void block_unmap(unsigned int block_num);
+
 // Get block device information
 //
 // @param block_size: Pointer to store block size (can be NULL)
@@ -59,4 +257,3 @@ int block_write_multiple(unsigned int start_block, unsigned int count, unsigned
 void block_get_info(unsigned int* block_size, unsigned int* total_blocks);
 
 #endif /* BLOCK_DOT_H */
-
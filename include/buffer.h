@@ -7,36 +7,109 @@
 // Caches recently used blocks in memory to reduce disk I/O
 // Simplified version inspired by Xv6
 
-#define NBUF 16  // Number of buffers in cache
+// Cache size, set once at init from free physical memory
+#define BUF_MEMORY_SHARE 64    // Block data takes at most 1/64 of free memory
+#define BUF_MIN          16    // Buffers at least
+#define BUF_MAX          4096  // Buffers at most (2MB of block data)
+#define BUF_READAHEAD_MAX BLOCK_MERGE_MAX  // Blocks one breadahead call loads at most
 
 // Buffer structure
+// Only the header lives here (one cache line on i386, lookup fields
+// first); the block itself is in a separate data slab
 typedef struct buf {
-    int valid;           // Has data been read from disk?
-    int disk;            // Does disk "own" buffer? (dirty flag)
     unsigned int blockno; // Block number
-    unsigned char data[512];  // Block data
     struct buf* next;    // Next buffer in hash chain
+    unsigned char* data;  // Block data (the mapped block, or store)
+    unsigned char* store; // Private copy (BLOCK_SIZE bytes in the data slab)
+    int valid;           // Has data been read from disk?
+    int dirty;           // Modified since it was last written to disk?
+    int mapped;          // Does data point straight into the device?
+    int refcnt;          // Holders between bread and brelse (never evicted while > 0)
+    struct buf* lru_prev; // Neighbours on the free list while refcnt == 0
+    struct buf* lru_next;
+    block_request_t req; // Last device request for this buffer
 } buf_t;
 
+// Buffer cache statistics
+typedef struct {
+    unsigned int buffers;       // Buffers in the cache
+    unsigned int hash_buckets;  // Hash table size (power of two)
+    unsigned int hits;          // bread calls served from the cache
+    unsigned int misses;        // bread calls that had to load the block
+    unsigned int evictions;     // Cached blocks dropped to make room
+    unsigned int writebacks;    // Dirty buffers written to disk
+    unsigned int readahead;     // Blocks loaded by breadahead
+} buffer_stats_t;
+
 // Initialize buffer cache
-// Sets up the buffer pool
+// Sizes the pool from free memory and allocates headers, data and hash
+// table; call after the block device is set up
 void buffer_init(void);
 
+// Get buffer cache statistics
+//
+// @param stats: Structure to fill
+void buffer_get_stats(buffer_stats_t* stats);
+
+// Zero the hit, miss, eviction, writeback and readahead counters
+void buffer_reset_stats(void);
+
 // Get buffer for a block
-// Returns cached buffer or reads from disk
+// Returns cached buffer or reads from disk; the buffer is referenced and
+// cannot be evicted until it is passed to brelse
 //
 // @param blockno: Block number
-// @return: Pointer to buffer, or NULL on error
+// @return: Pointer to buffer, or NULL on error or if every buffer is in use
 buf_t* bread(unsigned int blockno);
 
-// Write buffer to disk
-// Marks buffer as dirty and writes to disk
+// Prefetch blocks into the cache
+// Blocks that are not cached are loaded, each run of consecutive
+// block numbers with a single multi-block device read.
+// Does nothing on devices that can map blocks, where bread costs no I/O.
+//
+// @param blocks: Block numbers
+// @param count: Number of entries (at most BUF_READAHEAD_MAX are used)
+void breadahead(unsigned int* blocks, unsigned int count);
+
+// Find a cached block without doing any I/O
+// Lets callers that bypass the cache for bulk transfers stay coherent
+// with blocks that are cached. The buffer is not referenced.
+//
+// @param blockno: Block number
+// @return: Buffer holding the block's contents, or NULL if not cached
+buf_t* bfind(unsigned int blockno);
+
+// Drop a block from the cache
+// Called when a block is freed so its old contents are never served
+//
+// @param blockno: Block number
+void binvalidate(unsigned int blockno);
+
+// Mark buffer as modified
+// The block is written when the buffer is evicted or bflush runs, so
+// repeated updates to the same block cost one device write
+//
+// @param b: Pointer to buffer
+void bdirty(buf_t* b);
+
+// Write buffer to disk now
+// Queues the write on the block request queue and returns; the buffer
+// stays dirty until the write completes successfully, is not reused
+// before then, and synchronous block calls or block_flush drain the
+// queue first
 //
 // @param b: Pointer to buffer
 void bwrite(buf_t* b);
 
+// Write back every dirty buffer and flush the device
+// Buffers whose write fails stay dirty
+//
+// @return: 0 on success, -1 on error
+int bflush(void);
+
 // Release buffer
-// Marks buffer as available (doesn't write to disk)
+// Drops the reference taken by bread; the least recently released
+// unreferenced buffer is the next one evicted (doesn't write to disk)
 //
 // @param b: Pointer to buffer
 void brelse(buf_t* b);
@@ -45,13 +45,14 @@ int fs_create_file(char* path, char* content);
 int fs_delete_directory(char* path);
 int fs_delete_file(char* path);
 int fs_write_file(char* path, char* content);
-char* fs_read_file(char* path);
+char* fs_read_file(char* path);  // Returns scratch-arena memory, valid until the command ends
 int fs_list_directory(char* path, directory_t* result);
 int fs_change_directory(char* path);
 char* fs_get_current_path();
 
 // Initialize the simulated file system
-void filesystem_init();
+// Returns 0 on success, -1 if no file system could be mounted
+int filesystem_init();
 
 // Path utilities
 int parse_path(char* full_path, char* parent_path, char* name);
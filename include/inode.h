@@ -59,10 +59,17 @@ typedef struct {
 
 // File system functions
 
+// Allow formatting a persistent disk that holds no file system
+// Must be called before fs_xv6_init; RAM disks are always formatted
+//
+// @param enabled: Non-zero to format
+void fs_set_format(int enabled);
+
 // Initialize the file system
-// Creates superblock and initializes structures
+// Mounts the file system on the root device, formatting a RAM disk (or
+// a blank persistent disk when fs_set_format allowed it) that has none
 //
-// @return: 0 on success, -1 on error
+// @return: 0 on success, -1 on error (including an unformatted disk)
 int fs_xv6_init(void);
 
 // Allocate a new inode
@@ -105,6 +112,13 @@ unsigned int balloc(void);
 // @param block_num: Block number to free
 void bfree(unsigned int block_num);
 
+// Free a list of data blocks and discard them on the device
+// Runs of consecutive blocks are discarded with a single request
+//
+// @param blocks: Block numbers (0 entries are skipped)
+// @param count: Number of entries
+void bfree_blocks(unsigned int* blocks, unsigned int count);
+
 // Map logical block number to physical block number
 // Handles direct blocks (simplified - no indirect blocks)
 //
@@ -0,0 +1,62 @@
+#ifndef IO_DOT_H
+#define IO_DOT_H
+
+// x86 port I/O
+// Out of line so host builds can link their own versions
+
+// Read a byte from an I/O port
+//
+// @param port: Port number
+// @return: Byte read
+unsigned char inb(unsigned short port);
+
+// Write a byte to an I/O port
+//
+// @param port: Port number
+// @param value: Byte to write
+void outb(unsigned short port, unsigned char value);
+
+// Read a 16-bit word from an I/O port
+//
+// @param port: Port number
+// @return: Word read
+unsigned short inw(unsigned short port);
+
+// Write a 16-bit word to an I/O port
+//
+// @param port: Port number
+// @param value: Word to write
+void outw(unsigned short port, unsigned short value);
+
+// Read a 32-bit value from an I/O port
+//
+// @param port: Port number
+// @return: Value read
+unsigned int inl(unsigned short port);
+
+// Write a 32-bit value to an I/O port
+//
+// @param port: Port number
+// @param value: Value to write
+void outl(unsigned short port, unsigned int value);
+
+// Read a run of 16-bit words from an I/O port (rep insw)
+//
+// @param port: Port number
+// @param buffer: Destination (count words)
+// @param count: Number of words
+void insw(unsigned short port, void* buffer, unsigned int count);
+
+// Write a run of 16-bit words to an I/O port (rep outsw)
+//
+// @param port: Port number
+// @param buffer: Source (count words)
+// @param count: Number of words
+void outsw(unsigned short port, const void* buffer, unsigned int count);
+
+// Read the CPU timestamp counter
+//
+// @return: Cycles since reset
+unsigned long long rdtsc(void);
+
+#endif /* IO_DOT_H */
@@ -0,0 +1,42 @@
+#ifndef LZ_DOT_H
+#define LZ_DOT_H
+
+// Small LZ77 block codec
+// Byte-oriented format in the style of LZ4: each sequence is a token
+// (literal count in the high nibble, match length - 4 in the low one),
+// extra length bytes when a nibble is 15, the literals, then a 16-bit
+// little-endian back offset and extra match length bytes. The last
+// sequence carries literals only. Built for 512-byte disk blocks, so
+// it favours speed over ratio.
+
+#define LZ_MIN_MATCH   4       // Shortest match worth encoding
+#define LZ_MAX_OFFSET  65535   // Farthest back a match may start
+#define LZ_HASH_BITS   8       // Match finder table: 256 entries
+
+// Compressor working memory
+// Callers keep one per user (e.g. per disk) so lz_compress needs no stack
+// for it; the contents need not survive between calls
+typedef struct {
+    unsigned int table[1 << LZ_HASH_BITS];  // Last position of each hashed prefix
+} lz_state_t;
+
+// Compress a buffer
+//
+// @param state: Working memory
+// @param src: Input
+// @param length: Input size in bytes
+// @param dst: Output buffer
+// @param capacity: Output buffer size
+// @return: Compressed size, or 0 if it would not fit in capacity
+unsigned int lz_compress(lz_state_t* state, const unsigned char* src, unsigned int length, unsigned char* dst, unsigned int capacity);
+
+// Decompress a buffer
+//
+// @param src: Compressed input
+// @param length: Compressed size
+// @param dst: Output buffer
+// @param dst_length: Exact decompressed size expected
+// @return: 0 on success, -1 if the input is corrupt
+int lz_decompress(const unsigned char* src, unsigned int length, unsigned char* dst, unsigned int dst_length);
+
+#endif /* LZ_DOT_H */
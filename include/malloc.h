@@ -1,31 +1,134 @@
 #ifndef MALLOC_DOT_H
 #define MALLOC_DOT_H
 
+#include "pmm.h"
+
 // Simple memory allocator for kernel
-// Uses a simple linked list of free blocks
+// Small requests are served from per-size-class slabs,
+// larger ones from boundary-tagged blocks kept in segregated free bins.
+// The heap starts as one static chunk and grows by whole chunks taken
+// from the page-frame allocator; very large requests get their own pages.
 
 #define HEAP_START 0x1000000  // Start heap at 16MB (above kernel)
-#define HEAP_SIZE  0x100000   // 1MB heap size
+#define HEAP_SIZE  0x100000   // 1MB heap chunk size (chunks are aligned to it)
+#define HEAP_CHUNK_ORDER 8     // HEAP_SIZE as a page-run order
 #define MIN_BLOCK_SIZE 16      // Minimum allocation size
+#define BLOCK_ALIGN    8       // Alignment of block headers and sizes
+#define HEAP_BINS      32      // Free bins, one per power of two of block size
+#define CACHE_LINE_SIZE 64     // Alignment that keeps a buffer off shared cache lines
+
+#define HEAP_MAX_ALLOC (HEAP_SIZE / 2)  // Larger requests bypass the heap
+
+// Slab configuration
+// Requests up to SLAB_MAX_SIZE bytes are rounded up to a power-of-two
+// size class and carved out of dedicated pages
+#define SLAB_MIN_SIZE  16
+#define SLAB_MAX_SIZE  2048
+#define SLAB_CLASSES   8       // 16, 32, 64, 128, 256, 512, 1024, 2048
+#define HEAP_PAGES     (HEAP_SIZE / PAGE_SIZE)
 
 // Block header structure
 typedef struct block_header {
-    unsigned int size;         // Size of block (including header)
+    unsigned int size;          // Size of block (including header and footer)
     int free;                   // 1 if free, 0 if allocated
-    struct block_header* next;  // Next block in list
+    struct block_header* next;  // Next free block in bin (free blocks only)
+    struct block_header* prev;  // Previous free block in bin (free blocks only)
 } block_header_t;
 
+// Block footer (boundary tag)
+// Mirrors the header at the end of every block so kfree can
+// find the previous physical block in O(1)
+typedef struct block_footer {
+    unsigned int size;          // Size of block (same as header)
+    int free;                   // 1 if free, 0 if allocated
+} block_footer_t;
+
+// Slab descriptor (one per heap page used as a slab)
+// Kept in the chunk header so objects can use the whole page
+typedef struct slab {
+    struct slab_cache* cache;   // Owning size class (NULL if page is not a slab)
+    struct slab* next;          // Next slab in cache's partial list
+    struct slab* prev;          // Previous slab in cache's partial list
+    void* free;                 // Free objects in this slab (singly linked)
+    unsigned int inuse;         // Number of allocated objects
+} slab_t;
+
+// Size class cache
+typedef struct slab_cache {
+    unsigned int object_size;   // Size of each object in bytes
+    unsigned int objects;       // Objects per slab page
+    slab_t* partial;            // Slabs with at least one free object
+    unsigned int slabs;         // Slab pages owned by this class
+    unsigned int active;        // Objects currently allocated
+    unsigned int allocs;        // Total allocations since boot
+} slab_cache_t;
+
+// Heap chunk header
+// Sits at the start of every HEAP_SIZE-aligned chunk, followed by its blocks
+typedef struct heap_chunk {
+    struct heap_chunk* next;    // Next chunk in the heap
+    slab_t slabs[HEAP_PAGES];   // Slab descriptor for each page of the chunk
+} heap_chunk_t;
+
+// Heap statistics
+// All counters are kept up to date by kmalloc/kfree
+typedef struct {
+    unsigned int heap_size;     // Bytes in heap chunks
+    unsigned int in_use;        // Bytes handed out (rounded to class/block size)
+    unsigned int peak;          // Highest in_use since boot
+    unsigned int free_bytes;    // Bytes in free blocks
+    unsigned int free_blocks;   // Number of free blocks (fragments)
+    unsigned int largest_free;  // Largest free block in bytes
+    unsigned int page_bytes;    // Bytes in page runs (requests above HEAP_MAX_ALLOC)
+    unsigned int slab_pages;    // Heap pages used as slabs
+    unsigned int class_size[SLAB_CLASSES];    // Object size of each class
+    unsigned int class_active[SLAB_CLASSES];  // Live objects per class
+    unsigned int class_allocs[SLAB_CLASSES];  // Total allocations per class
+} heap_stats_t;
+
 // Initialize the heap
 void heap_init(void);
 
 // Allocate memory (similar to malloc)
 void* kmalloc(unsigned int size);
 
+// Allocate memory aligned to a power of two
+// Freed with kfree like any other allocation
+//
+// @param size: Number of bytes to allocate
+// @param align: Alignment of the returned pointer (power of two, at most HEAP_SIZE)
+// @return: Pointer to allocated memory, or NULL if out of memory or align is invalid
+void* kmalloc_aligned(unsigned int size, unsigned int align);
+
+// Allocate whole pages
+//
+// @param count: Number of pages
+// @return: Page-aligned pointer to count * PAGE_SIZE bytes, or NULL if out of memory
+void* kmalloc_pages(unsigned int count);
+
 // Free memory (similar to free)
 void kfree(void* ptr);
 
+// Resize an allocation (similar to realloc)
+// Heap blocks grow into a free neighbour and shrink in place when possible
+//
+// @param ptr: Allocation to resize (NULL acts like kmalloc)
+// @param size: New size in bytes (0 frees ptr)
+// @return: Pointer to the resized memory (may move), or NULL if out of memory
+//          (ptr is then left untouched)
+void* krealloc(void* ptr, unsigned int size);
+
+// Free pages from kmalloc_pages
+//
+// @param ptr: Pointer returned by kmalloc_pages
+void kfree_pages(void* ptr);
+
 // Get total allocated memory (for debugging)
 unsigned int get_allocated_memory(void);
 
-#endif /* MALLOC_DOT_H */
+// Get heap statistics
+//
+// @param stats: Structure to fill
+void heap_get_stats(heap_stats_t* stats);
 
+#endif /* MALLOC_DOT_H */
@@ -0,0 +1,42 @@
+#ifndef MULTIBOOT_DOT_H
+#define MULTIBOOT_DOT_H
+
+// Multiboot (v1) boot information
+// Filled in by the bootloader and passed to main in ebx
+
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002  // Value of eax on entry
+
+// multiboot_info_t flags: which fields are valid
+#define MULTIBOOT_INFO_MEMORY   0x001  // mem_lower / mem_upper
+#define MULTIBOOT_INFO_CMDLINE  0x004  // cmdline
+#define MULTIBOOT_INFO_MEM_MAP  0x040  // mmap_length / mmap_addr
+
+// Memory map entry types
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+// Boot information structure (only the fields we use are named)
+typedef struct {
+    unsigned int flags;        // Which fields below are valid
+    unsigned int mem_lower;    // KiB of memory below 1MB
+    unsigned int mem_upper;    // KiB of memory above 1MB
+    unsigned int boot_device;
+    unsigned int cmdline;      // Physical address of kernel command line
+    unsigned int mods_count;
+    unsigned int mods_addr;
+    unsigned int syms[4];
+    unsigned int mmap_length;  // Size of the memory map buffer in bytes
+    unsigned int mmap_addr;    // Physical address of the memory map buffer
+} multiboot_info_t;
+
+// Memory map entry
+// `size` does not include itself: the next entry is at (addr + size + 4)
+typedef struct {
+    unsigned int size;         // Size of the rest of this entry
+    unsigned int base_low;     // Region start address (low 32 bits)
+    unsigned int base_high;    // Region start address (high 32 bits)
+    unsigned int length_low;   // Region length (low 32 bits)
+    unsigned int length_high;  // Region length (high 32 bits)
+    unsigned int type;         // MULTIBOOT_MEMORY_AVAILABLE or reserved
+} multiboot_mmap_entry_t;
+
+#endif /* MULTIBOOT_DOT_H */
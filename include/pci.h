@@ -0,0 +1,84 @@
+#ifndef PCI_DOT_H
+#define PCI_DOT_H
+
+// PCI bus access
+// Uses configuration mechanism #1 (ports 0xCF8/0xCFC) to enumerate
+// devices and read or program their configuration space.
+
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+
+#define PCI_MAX_BUSES       256
+#define PCI_MAX_DEVICES     32
+#define PCI_MAX_FUNCTIONS   8
+
+// Configuration space offsets
+#define PCI_VENDOR_ID       0x00  // 16-bit vendor, 16-bit device
+#define PCI_COMMAND         0x04  // 16-bit command, 16-bit status
+#define PCI_CLASS           0x08  // Revision, prog IF, subclass, class
+#define PCI_HEADER_TYPE     0x0C  // Cache line, latency, header type, BIST
+#define PCI_BAR0            0x10  // Base address registers (6 x 32-bit)
+
+#define PCI_COMMAND_IO          0x0001  // Respond to I/O space accesses
+#define PCI_COMMAND_MEMORY      0x0002  // Respond to memory space accesses
+#define PCI_COMMAND_BUS_MASTER  0x0004  // Allow the device to issue DMA
+
+#define PCI_VENDOR_NONE     0xFFFF  // Read from an empty slot
+
+// PCI function location and identity
+typedef struct {
+    unsigned char bus;
+    unsigned char device;
+    unsigned char function;
+    unsigned short vendor_id;
+    unsigned short device_id;
+    unsigned char class_code;
+    unsigned char subclass;
+    unsigned char prog_if;
+} pci_device_t;
+
+// Read a 32-bit configuration register
+//
+// @param dev: Device
+// @param offset: Register offset (rounded down to a multiple of 4)
+// @return: Register value
+unsigned int pci_config_read(const pci_device_t* dev, unsigned char offset);
+
+// Write a 32-bit configuration register
+//
+// @param dev: Device
+// @param offset: Register offset (rounded down to a multiple of 4)
+// @param value: Value to write
+void pci_config_write(const pci_device_t* dev, unsigned char offset, unsigned int value);
+
+// Read a base address register
+//
+// @param dev: Device
+// @param bar: BAR number (0-5)
+// @return: Raw BAR value (bit 0 set for I/O space)
+unsigned int pci_read_bar(const pci_device_t* dev, int bar);
+
+// Find a device by class
+//
+// @param class_code: Base class (e.g. 0x01 for mass storage)
+// @param subclass: Subclass (e.g. 0x01 for IDE)
+// @param index: Which match to return (0 for the first)
+// @param dev: Filled in on success
+// @return: 0 on success, -1 if there is no such device
+int pci_find_class(unsigned char class_code, unsigned char subclass, int index, pci_device_t* dev);
+
+// Find a device by vendor and device ID
+//
+// @param vendor_id: Vendor ID
+// @param device_id: Device ID
+// @param index: Which match to return (0 for the first)
+// @param dev: Filled in on success
+// @return: 0 on success, -1 if there is no such device
+int pci_find_device(unsigned short vendor_id, unsigned short device_id, int index, pci_device_t* dev);
+
+// Let a device decode its I/O and memory BARs and master the bus (DMA)
+//
+// @param dev: Device
+void pci_enable_bus_master(const pci_device_t* dev);
+
+#endif /* PCI_DOT_H */
@@ -0,0 +1,73 @@
+#ifndef PMM_DOT_H
+#define PMM_DOT_H
+
+#include "multiboot.h"
+
+// Physical page-frame allocator
+// Buddy system over the memory reported by the bootloader:
+// allocates and frees runs of 2^order contiguous pages in O(log n)
+
+#define PAGE_SIZE      4096
+#define PAGE_SHIFT     12
+#define PMM_MAX_ORDER  16    // Largest run: 2^16 pages (256MB)
+
+// Frame flags
+#define PAGE_RESERVED  0x01  // Not available (kernel, firmware, holes)
+#define PAGE_FREE      0x02  // Head of a free run
+#define PAGE_ALLOCATED 0x04  // Head of an allocated run
+
+// Per-frame descriptor
+// Only the first frame of a run (its head) carries flags and order
+typedef struct {
+    unsigned char flags;   // PAGE_* flags
+    unsigned char order;   // Run size as a power of two (heads only)
+} page_frame_t;
+
+// Initialize from the multiboot memory map
+// Memory below reserved_end (the kernel image) is never handed out
+//
+// @param mbi: Boot information from the bootloader
+// @param reserved_end: End address of the kernel image
+// @return: 0 on success, -1 on error
+int pmm_init(multiboot_info_t* mbi, unsigned long reserved_end);
+
+// Initialize over a single contiguous range of available memory
+//
+// @param start: Start address of the range
+// @param end: End address of the range (exclusive)
+// @return: 0 on success, -1 on error
+int pmm_init_range(unsigned long start, unsigned long end);
+
+// Allocate 2^order contiguous pages
+// The run is aligned to its own size
+//
+// @param order: Run size as a power of two (0 = one page)
+// @return: Address of the first page, or NULL if out of memory
+void* pmm_alloc_pages(unsigned int order);
+
+// Allocate a physically contiguous range of any number of pages
+// Slow (scans every frame); meant for boot-time carve-outs
+//
+// @param pages: Number of pages
+// @return: Address of the first page, or NULL if no free span is large enough
+void* pmm_alloc_contiguous(unsigned int pages);
+
+// Free a run returned by pmm_alloc_pages
+//
+// @param addr: Address of the first page of the run
+// @return: Number of pages freed (0 if addr is not an allocated run)
+unsigned int pmm_free_pages(void* addr);
+
+// Get the size of an allocated run
+//
+// @param addr: Address of the first page of the run
+// @return: Number of pages in the run (0 if addr is not an allocated run)
+unsigned int pmm_run_pages(void* addr);
+
+// Get page-frame allocator information
+//
+// @param total: Pointer to store number of managed pages (can be NULL)
+// @param free: Pointer to store number of free pages (can be NULL)
+void pmm_get_info(unsigned int* total, unsigned int* free);
+
+#endif /* PMM_DOT_H */
@@ -2,56 +2,107 @@
 #define RAMDISK_DOT_H
 
 #include "malloc.h"
+#include "block.h"
+#include "lz.h"
 
 // RAM Disk Configuration
-// Simulates a disk drive using memory
-#define RAMDISK_SIZE        (1024 * 1024)  // 1MB disk
-#define BLOCK_SIZE          512            // Standard disk sector size
-#define RAMDISK_BLOCKS      (RAMDISK_SIZE / BLOCK_SIZE)  // 2048 blocks
+// Simulates a disk drive using a contiguous region of physical memory
+// carved out at boot, sized from installed RAM or the `ramdisk=` boot option.
+// Blocks are zeroed lazily: a bitmap records which blocks have ever been
+// written, and the rest read as zeros without touching backing memory.
+#define RAMDISK_RAM_SHARE     2              // Default size: 1/2 of free physical memory
+#define RAMDISK_MIN_SIZE      (64 * 1024)    // Smallest disk we will try to carve
+#define RAMDISK_FALLBACK_SIZE (256 * 1024)   // Heap-backed disk when no physical region is available
+#define RAMDISK_MAX_DISKS     4              // Boot disk plus extra disks from ramdisk_create
+
+// Compressed mode
+// Each block is stored on its own in a heap allocation sized to its
+// compressed form (so small blocks land in small slab classes). All-zero
+// blocks take no storage, blocks that do not shrink enough are kept raw,
+// and the most recently used blocks stay uncompressed in a small
+// write-back hot cache so repeated access skips the codec.
+#define RAMDISK_COMPRESS_FACTOR 2            // Default compressed disk: this many times the memory share
+#define RAMDISK_HOT_BLOCKS      32           // Uncompressed blocks cached per disk
+#define RAMDISK_RAW_LIMIT       (BLOCK_SIZE - BLOCK_SIZE / 8)  // Keep raw unless compressed below this
+
+// Hot cache entry (compressed mode)
+typedef struct {
+    unsigned int block;       // Block number
+    int valid;                // Holds a block
+    int dirty;                // Newer than the stored form
+    unsigned int last_use;    // Tick of the last access (LRU)
+    unsigned char* data;      // BLOCK_SIZE bytes
+} ramdisk_hot_t;
+
+// Compression statistics (compressed mode)
+typedef struct {
+    unsigned int stored_blocks;       // Blocks holding data (all-zero blocks excluded)
+    unsigned int stored_bytes;        // Their stored size
+    unsigned int raw_blocks;          // Stored blocks that did not compress
+    unsigned int zero_stores;         // Writebacks of all-zero blocks (stored as a flag)
+    unsigned int hot_hits;            // Accesses served by the hot cache
+    unsigned int hot_misses;          // Accesses that went to the stored form
+    unsigned int compressions;
+    unsigned int decompressions;
+    unsigned long long compress_cycles;    // Time in lz_compress
+    unsigned long long decompress_cycles;  // Time in lz_decompress
+} ramdisk_compress_stats_t;
 
 // RAM Disk structure
 typedef struct {
-    unsigned char* data;      // Memory backing the disk
+    unsigned char* data;      // Memory backing the disk (NULL in compressed mode)
+    unsigned int* written;    // Bit per block: set once the block holds data (NULL = all written)
     unsigned int size;        // Total size in bytes
     unsigned int block_count; // Number of blocks
+    int device;               // Block device number
     int initialized;          // Initialization flag
+
+    // Compressed mode only
+    int compressed;                   // Blocks are stored compressed
+    unsigned char** blocks;           // Stored form per block (NULL = all zeros)
+    unsigned short* lengths;          // Stored size per block (BLOCK_SIZE = raw)
+    ramdisk_hot_t hot[RAMDISK_HOT_BLOCKS];
+    unsigned int hot_tick;            // Access counter for LRU
+    lz_state_t* lz;                   // Compressor working memory
+    unsigned char* packed;            // Compression output (RAMDISK_RAW_LIMIT bytes)
+    ramdisk_compress_stats_t stats;
 } ramdisk_t;
 
-// Initialize RAM disk
-// Allocates memory and sets up the disk structure
-int ramdisk_init(void);
+// Set the RAM disk size
+// Must be called before ramdisk_init; 0 selects the default size
+//
+// @param size: Disk size in bytes
+void ramdisk_set_size(unsigned int size);
 
-// Read a block from RAM disk
-// 
-// @param block_num: Block number to read (0-indexed)
-// @param buffer: Buffer to store read data (must be at least BLOCK_SIZE bytes)
-// @return: 0 on success, -1 on error
-int ramdisk_read_block(unsigned int block_num, unsigned char* buffer);
+// Select compressed mode for RAM disks created from now on
+// Must be called before ramdisk_init to affect the boot disk, whose
+// default size then becomes RAMDISK_COMPRESS_FACTOR times larger
+//
+// @param enabled: Non-zero to compress
+void ramdisk_set_compression(int enabled);
 
-// Write a block to RAM disk
+// Initialize RAM disk
+// Allocates memory for the boot disk and registers it as a block device
 //
-// @param block_num: Block number to write (0-indexed)
-// @param buffer: Data to write (must be BLOCK_SIZE bytes)
 // @return: 0 on success, -1 on error
-int ramdisk_write_block(unsigned int block_num, unsigned char* buffer);
+int ramdisk_init(void);
 
-// Read multiple blocks
+// Create an additional RAM disk
+// Its memory is carved from physical memory (or the heap as a fallback)
+// and the disk is registered as a new block device
 //
-// @param start_block: Starting block number
-// @param count: Number of blocks to read
-// @param buffer: Buffer to store data (must be count * BLOCK_SIZE bytes)
-// @return: 0 on success, -1 on error
-int ramdisk_read_blocks(unsigned int start_block, unsigned int count, unsigned char* buffer);
+// @param size: Disk size in bytes (rounded down to whole pages)
+// @return: Block device number, or -1 on error
+int ramdisk_create(unsigned int size);
 
-// Write multiple blocks
+// Get compression statistics of a RAM disk
 //
-// @param start_block: Starting block number
-// @param count: Number of blocks to write
-// @param buffer: Data to write (must be count * BLOCK_SIZE bytes)
-// @return: 0 on success, -1 on error
-int ramdisk_write_blocks(unsigned int start_block, unsigned int count, unsigned char* buffer);
+// @param device: Block device number
+// @param stats: Filled in on success
+// @return: 0 on success, -1 if the device is not a compressed RAM disk
+int ramdisk_get_compress_stats(int device, ramdisk_compress_stats_t* stats);
 
-// Get RAM disk information
+// Get RAM disk information (boot disk)
 //
 // @param size: Pointer to store total size (can be NULL)
 // @param blocks: Pointer to store block count (can be NULL)
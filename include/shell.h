@@ -55,6 +55,9 @@ int cmd_cd(char** args);
 int cmd_touch(char** args);
 int cmd_del(char** args);
 int cmd_cat(char** args);
+int cmd_meminfo(char** args);
+int cmd_iostat(char** args);
+int cmd_sync(char** args);
 
 // Utility funcs
 void print_prompt();
@@ -20,6 +20,13 @@ void clear_screen(void);
 void backspace_char(void);
 void scroll_screen_up(void);
 
+// Memory util funcs
+// Word-at-a-time (rep movsd/stosd on x86) after aligning the destination
+void* memcpy(void* dest, const void* src, unsigned int n);
+void* memmove(void* dest, const void* src, unsigned int n);
+void* memset(void* dest, int c, unsigned int n);
+int memcmp(const void* s1, const void* s2, unsigned int n);
+
 // String util funcs
 int strlen(const char* str);
 int strcmp(const char* s1, const char* s2);
@@ -28,6 +35,7 @@ char* strcat(char* dest, const char* src);
 char* strncpy(char* dest, const char* src, int n);
 char* strchr(const char* str, int c);
 char* strrchr(const char* str, int c);
+char* utoa(unsigned int value, char* str, int base);
 
 // Formatted output funcs
 void print_formatted_string(char* str, unsigned char color);
@@ -0,0 +1,121 @@
+#ifndef VIRTIO_DOT_H
+#define VIRTIO_DOT_H
+
+#include "pci.h"
+#include "block.h"
+
+// virtio block device driver
+// Talks to virtio-blk disks through the legacy (transitional) PCI
+// interface: one I/O BAR holds the device registers, and a single
+// virtqueue carries requests. Each block call queues its requests as
+// descriptor chains (header, data, status) and notifies the device once
+// for the whole batch. Completion is polled from the used ring, since
+// the kernel has no interrupt handling yet.
+
+#define VIRTIO_VENDOR_ID        0x1AF4
+#define VIRTIO_BLK_DEVICE_ID    0x1001  // Transitional virtio-blk
+#define VIRTIO_BLK_MAX_DISKS    4
+
+// Legacy PCI register offsets (from BAR0)
+#define VIRTIO_REG_DEVICE_FEATURES  0x00  // 32-bit
+#define VIRTIO_REG_GUEST_FEATURES   0x04  // 32-bit
+#define VIRTIO_REG_QUEUE_ADDRESS    0x08  // 32-bit page frame number
+#define VIRTIO_REG_QUEUE_SIZE       0x0C  // 16-bit
+#define VIRTIO_REG_QUEUE_SELECT     0x0E  // 16-bit
+#define VIRTIO_REG_QUEUE_NOTIFY     0x10  // 16-bit
+#define VIRTIO_REG_DEVICE_STATUS    0x12  // 8-bit
+#define VIRTIO_REG_ISR_STATUS       0x13  // 8-bit
+#define VIRTIO_REG_CONFIG           0x14  // Device-specific configuration
+
+// Device status bits
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FAILED        0x80
+
+// virtio-blk feature bits
+#define VIRTIO_BLK_F_SIZE_MAX       (1u << 1)  // Limit on bytes per data descriptor
+#define VIRTIO_BLK_F_SEG_MAX        (1u << 2)  // Limit on data descriptors per request
+#define VIRTIO_BLK_F_FLUSH          (1u << 9)  // Device has a write cache to flush
+
+// virtio-blk configuration offsets (from VIRTIO_REG_CONFIG)
+#define VIRTIO_BLK_CFG_CAPACITY     0x00  // 64-bit, in 512-byte sectors
+#define VIRTIO_BLK_CFG_SIZE_MAX     0x08  // 32-bit
+#define VIRTIO_BLK_CFG_SEG_MAX      0x0C  // 32-bit
+
+// Request types and status
+#define VIRTIO_BLK_T_IN             0
+#define VIRTIO_BLK_T_OUT            1
+#define VIRTIO_BLK_T_FLUSH          4
+#define VIRTIO_BLK_S_OK             0
+
+// Descriptor flags
+#define VIRTQ_DESC_F_NEXT           1  // Chain continues in `next`
+#define VIRTQ_DESC_F_WRITE          2  // Device writes this buffer
+#define VIRTQ_AVAIL_F_NO_INTERRUPT  1  // We poll; no interrupt needed
+
+#define VIRTQ_ALIGN                 4096  // Legacy used-ring alignment
+#define VIRTIO_TIMEOUT              100000000  // Used-ring polls before giving up
+
+// Virtqueue descriptor
+typedef struct {
+    unsigned long long address;  // Physical address
+    unsigned int length;         // Bytes
+    unsigned short flags;        // VIRTQ_DESC_F_*
+    unsigned short next;         // Next descriptor in the chain
+} virtq_desc_t;
+
+// Driver-to-device ring (ring[] follows the header)
+typedef struct {
+    unsigned short flags;
+    unsigned short index;
+    unsigned short ring[];
+} virtq_avail_t;
+
+// Completed chain
+typedef struct {
+    unsigned int id;             // Head descriptor of the chain
+    unsigned int length;         // Bytes the device wrote
+} virtq_used_elem_t;
+
+// Device-to-driver ring (ring[] follows the header)
+typedef struct {
+    unsigned short flags;
+    unsigned short index;
+    virtq_used_elem_t ring[];
+} virtq_used_t;
+
+// Request header and status for one chain
+typedef struct {
+    unsigned int type;           // VIRTIO_BLK_T_*
+    unsigned int reserved;
+    unsigned long long sector;   // First sector
+    unsigned char status;        // Written by the device
+} virtio_blk_req_t;
+
+// virtio-blk disk
+typedef struct {
+    unsigned short io;           // BAR0 I/O base
+    unsigned int features;       // Negotiated features
+    unsigned int size_max;       // Bytes per data descriptor (multiple of BLOCK_SIZE)
+    unsigned int seg_max;        // Data descriptors per request
+    unsigned int queue_size;     // Descriptors in the virtqueue
+    virtq_desc_t* desc;          // Descriptor table
+    virtq_avail_t* avail;        // Available ring
+    virtq_used_t* used;          // Used ring
+    virtio_blk_req_t* reqs;      // Header/status per head descriptor
+    unsigned int next_desc;      // Descriptors taken by the current batch
+    unsigned short avail_index;  // Our copy of avail->index
+    unsigned short used_index;   // Used entries already consumed
+    unsigned int capacity;       // Size in sectors
+    int device;                  // Block device number
+} virtio_blk_t;
+
+// Initialize virtio block disks
+// Finds every virtio-blk PCI function, sets up its virtqueue and
+// registers it as a block device
+//
+// @return: Number of disks registered
+int virtio_blk_init(void);
+
+#endif /* VIRTIO_DOT_H */
@@ -0,0 +1,94 @@
+#include "arena.h"
+#include "malloc.h"
+#include "source.h"
+
+// Per-command scratch arena
+arena_t scratch_arena;
+
+// Offset of the data area in a block (keeps allocations aligned)
+#define ARENA_HEADER ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+/**
+ * Add a block to an arena
+ *
+ * @param arena: Arena to grow
+ * @param size: Minimum usable size of the block
+ * @return: New block, or NULL if out of memory
+ */
+static arena_block_t* arena_grow(arena_t* arena, unsigned int size)
+{
+    if (size < ARENA_BLOCK_SIZE) {
+        size = ARENA_BLOCK_SIZE;
+    }
+
+    arena_block_t* block = (arena_block_t*)kmalloc(ARENA_HEADER + size);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    if (arena->current) {
+        arena->current->next = block;
+    } else {
+        arena->first = block;
+    }
+    arena->current = block;
+
+    return block;
+}
+
+/**
+ * Allocate memory from an arena
+ * Costs a pointer bump unless the current block is full
+ *
+ * @param arena: Arena to allocate from
+ * @param size: Number of bytes to allocate
+ * @return: Pointer to memory, or NULL if out of memory
+ */
+void* arena_alloc(arena_t* arena, unsigned int size)
+{
+    if (arena == NULL || size == 0) {
+        return NULL;
+    }
+
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    arena_block_t* block = arena->current;
+    if (block == NULL || block->size - block->used < size) {
+        block = arena_grow(arena, size);
+        if (block == NULL) {
+            return NULL;  // Out of memory
+        }
+    }
+
+    char* ptr = (char*)block + ARENA_HEADER + block->used;
+    block->used += size;
+    return ptr;
+}
+
+/**
+ * Release everything allocated from an arena
+ * Blocks beyond the first go back to the heap
+ *
+ * @param arena: Arena to reset
+ */
+void arena_reset(arena_t* arena)
+{
+    if (arena == NULL || arena->first == NULL) {
+        return;
+    }
+
+    arena_block_t* block = arena->first->next;
+    while (block != NULL) {
+        arena_block_t* next = block->next;
+        kfree(block);
+        block = next;
+    }
+
+    arena->first->next = NULL;
+    arena->first->used = 0;
+    arena->current = arena->first;
+}
@@ -0,0 +1,449 @@
+#include "ata.h"
+#include "io.h"
+#include "malloc.h"
+#include "source.h"
+
+static ata_channel_t g_ata_channels[2];
+static ata_drive_t g_ata_drives[ATA_MAX_DRIVES];
+static int g_ata_drive_count = 0;
+
+/**
+ * Wait about 400ns by reading the alternate status register
+ * Gives the drive time to update its status after a command or select
+ *
+ * @param channel: IDE channel
+ */
+static void ata_delay(ata_channel_t* channel)
+{
+    for (int i = 0; i < 4; i++) {
+        inb(channel->ctrl);
+    }
+}
+
+/**
+ * Wait until the drive is no longer busy
+ *
+ * @param channel: IDE channel
+ * @return: Final status, or -1 on timeout
+ */
+static int ata_wait_idle(ata_channel_t* channel)
+{
+    for (unsigned int i = 0; i < ATA_TIMEOUT; i++) {
+        unsigned char status = inb(channel->io + ATA_REG_STATUS);
+        if (!(status & ATA_SR_BSY)) {
+            return status;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Wait until the drive is ready to move a sector of data
+ *
+ * @param channel: IDE channel
+ * @return: 0 when DRQ is set, -1 on error or timeout
+ */
+static int ata_wait_drq(ata_channel_t* channel)
+{
+    int status = ata_wait_idle(channel);
+    if (status < 0 || (status & (ATA_SR_ERR | ATA_SR_DF)) || !(status & ATA_SR_DRQ)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Select a drive and load the task file for an LBA28 command
+ *
+ * @param drive: ATA drive
+ * @param lba: First sector
+ * @param count: Number of sectors (1 to ATA_MAX_SECTORS)
+ * @return: 0 on success, -1 if the drive stayed busy
+ */
+static int ata_setup(ata_drive_t* drive, unsigned int lba, unsigned int count)
+{
+    ata_channel_t* channel = drive->channel;
+
+    if (ata_wait_idle(channel) < 0) {
+        return -1;
+    }
+
+    outb(channel->io + ATA_REG_DRIVE, 0xE0 | (drive->slave << 4) | ((lba >> 24) & 0x0F));
+    ata_delay(channel);
+
+    outb(channel->io + ATA_REG_SECCOUNT, count & 0xFF);  // 256 is encoded as 0
+    outb(channel->io + ATA_REG_LBA_LO, lba & 0xFF);
+    outb(channel->io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
+    outb(channel->io + ATA_REG_LBA_HI, (lba >> 16) & 0xFF);
+    return 0;
+}
+
+/**
+ * Transfer sectors with programmed I/O
+ *
+ * @param drive: ATA drive
+ * @param lba: First sector
+ * @param count: Number of sectors (1 to ATA_MAX_SECTORS)
+ * @param buffer: Data buffer (count * BLOCK_SIZE bytes)
+ * @param write: Non-zero to write, zero to read
+ * @return: 0 on success, -1 on error
+ */
+static int ata_pio(ata_drive_t* drive, unsigned int lba, unsigned int count, unsigned char* buffer, int write)
+{
+    ata_channel_t* channel = drive->channel;
+
+    if (ata_setup(drive, lba, count) != 0) {
+        return -1;
+    }
+    outb(channel->io + ATA_REG_COMMAND, write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO);
+    ata_delay(channel);
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (ata_wait_drq(channel) != 0) {
+            return -1;
+        }
+        if (write) {
+            outsw(channel->io + ATA_REG_DATA, buffer + i * BLOCK_SIZE, BLOCK_SIZE / 2);
+        } else {
+            insw(channel->io + ATA_REG_DATA, buffer + i * BLOCK_SIZE, BLOCK_SIZE / 2);
+        }
+        ata_delay(channel);
+    }
+
+    int status = ata_wait_idle(channel);
+    return (status < 0 || (status & (ATA_SR_ERR | ATA_SR_DF))) ? -1 : 0;
+}
+
+/**
+ * Fill the channel's descriptor table for one buffer
+ * Regions are split so that none crosses a 64 KiB boundary
+ *
+ * @param channel: IDE channel
+ * @param buffer: Data buffer (identity-mapped, so its address is physical)
+ * @param bytes: Transfer size
+ * @return: 0 on success, -1 if the buffer needs too many descriptors
+ */
+static int ata_build_prdt(ata_channel_t* channel, unsigned char* buffer, unsigned int bytes)
+{
+    unsigned int address = (unsigned int)(unsigned long)buffer;
+    int n = 0;
+
+    while (bytes > 0) {
+        if (n == ATA_PRD_ENTRIES) {
+            return -1;
+        }
+
+        unsigned int chunk = ATA_PRD_BOUNDARY - (address & (ATA_PRD_BOUNDARY - 1));
+        if (chunk > bytes) {
+            chunk = bytes;
+        }
+
+        channel->prdt[n].address = address;
+        channel->prdt[n].size = chunk & 0xFFFF;  // 64 KiB is encoded as 0
+        channel->prdt[n].flags = 0;
+
+        address += chunk;
+        bytes -= chunk;
+        n++;
+    }
+
+    channel->prdt[n - 1].flags = ATA_PRD_EOT;
+    return 0;
+}
+
+/**
+ * Transfer sectors with bus-master DMA
+ * The drive moves the data itself; we poll until the engine goes idle
+ *
+ * @param drive: ATA drive
+ * @param lba: First sector
+ * @param count: Number of sectors (1 to ATA_MAX_SECTORS)
+ * @param buffer: Data buffer (count * BLOCK_SIZE bytes, word aligned)
+ * @param write: Non-zero to write, zero to read
+ * @return: 0 on success, -1 on error
+ */
+static int ata_dma(ata_drive_t* drive, unsigned int lba, unsigned int count, unsigned char* buffer, int write)
+{
+    ata_channel_t* channel = drive->channel;
+    unsigned short bm = channel->bmide;
+    unsigned char direction = write ? 0 : ATA_BM_CMD_READ;
+
+    if (ata_build_prdt(channel, buffer, count * BLOCK_SIZE) != 0) {
+        return -1;
+    }
+
+    // Stop the engine, load the table and clear stale error/interrupt bits
+    outb(bm + ATA_BM_COMMAND, direction);
+    outl(bm + ATA_BM_PRDT, (unsigned int)(unsigned long)channel->prdt);
+    outb(bm + ATA_BM_STATUS, inb(bm + ATA_BM_STATUS) | ATA_BM_SR_ERR | ATA_BM_SR_IRQ);
+
+    if (ata_setup(drive, lba, count) != 0) {
+        return -1;
+    }
+    outb(channel->io + ATA_REG_COMMAND, write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+    outb(bm + ATA_BM_COMMAND, direction | ATA_BM_CMD_START);
+
+    unsigned char bm_status = 0;
+    int status = -1;
+    for (unsigned int i = 0; i < ATA_TIMEOUT; i++) {
+        bm_status = inb(bm + ATA_BM_STATUS);
+        if (bm_status & ATA_BM_SR_ERR) {
+            break;
+        }
+        if (!(bm_status & ATA_BM_SR_ACTIVE)) {
+            status = ata_wait_idle(channel);
+            break;
+        }
+    }
+
+    outb(bm + ATA_BM_COMMAND, direction);
+    outb(bm + ATA_BM_STATUS, bm_status | ATA_BM_SR_ERR | ATA_BM_SR_IRQ);
+
+    if (status < 0 || (bm_status & ATA_BM_SR_ERR) || (status & (ATA_SR_ERR | ATA_SR_DF))) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Transfer a range of sectors, one command per ATA_MAX_SECTORS
+ * DMA is used when possible; a drive whose DMA fails drops to PIO for good
+ *
+ * @param drive: ATA drive
+ * @param lba: First sector
+ * @param count: Number of sectors
+ * @param buffer: Data buffer (count * BLOCK_SIZE bytes)
+ * @param write: Non-zero to write, zero to read
+ * @return: 0 on success, -1 on error
+ */
+static int ata_transfer(ata_drive_t* drive, unsigned int lba, unsigned int count, unsigned char* buffer, int write)
+{
+    // Bus masters move whole words
+    int aligned = ((unsigned long)buffer & 1) == 0;
+
+    while (count > 0) {
+        unsigned int n = (count > ATA_MAX_SECTORS) ? ATA_MAX_SECTORS : count;
+
+        int result = -1;
+        if (drive->dma && aligned) {
+            result = ata_dma(drive, lba, n, buffer, write);
+            if (result != 0) {
+                drive->dma = 0;
+            }
+        }
+        if (result != 0 && ata_pio(drive, lba, n, buffer, write) != 0) {
+            return -1;
+        }
+
+        lba += n;
+        count -= n;
+        buffer += n * BLOCK_SIZE;
+    }
+
+    return 0;
+}
+
+/**
+ * Read sectors from an ATA disk
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param count: Number of blocks to read
+ * @param buffer: Buffer to store data (must be count * BLOCK_SIZE bytes)
+ * @return: 0 on success, -1 on error
+ */
+static int ata_read(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    return ata_transfer((ata_drive_t*)dev->driver_data, start_block, count, buffer, 0);
+}
+
+/**
+ * Write sectors to an ATA disk
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param count: Number of blocks to write
+ * @param buffer: Data to write (must be count * BLOCK_SIZE bytes)
+ * @return: 0 on success, -1 on error
+ */
+static int ata_write(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    return ata_transfer((ata_drive_t*)dev->driver_data, start_block, count, buffer, 1);
+}
+
+/**
+ * Flush the drive's write cache to the medium
+ *
+ * @param dev: Block device
+ * @return: 0 on success, -1 on error
+ */
+static int ata_flush(block_device_t* dev)
+{
+    ata_drive_t* drive = (ata_drive_t*)dev->driver_data;
+    ata_channel_t* channel = drive->channel;
+
+    if (ata_wait_idle(channel) < 0) {
+        return -1;
+    }
+
+    outb(channel->io + ATA_REG_DRIVE, 0xE0 | (drive->slave << 4));
+    ata_delay(channel);
+    outb(channel->io + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
+    ata_delay(channel);
+
+    int status = ata_wait_idle(channel);
+    return (status < 0 || (status & (ATA_SR_ERR | ATA_SR_DF))) ? -1 : 0;
+}
+
+static const block_driver_t ata_driver = {
+    .name = "ata",
+    .persistent = 1,
+    .read = ata_read,
+    .write = ata_write,
+    .readv = NULL,
+    .writev = NULL,
+    .flush = ata_flush,
+    .discard = NULL,
+    .map = NULL,
+    .unmap = NULL,
+};
+
+/**
+ * Identify the drive at a channel position
+ *
+ * @param channel: IDE channel
+ * @param slave: 0 for master, 1 for slave
+ * @param drive: Filled in when an ATA disk answers
+ * @return: 0 if an ATA disk is present, -1 otherwise
+ */
+static int ata_identify(ata_channel_t* channel, unsigned char slave, ata_drive_t* drive)
+{
+    unsigned short identify[256];
+
+    outb(channel->io + ATA_REG_DRIVE, 0xA0 | (slave << 4));
+    ata_delay(channel);
+
+    outb(channel->io + ATA_REG_SECCOUNT, 0);
+    outb(channel->io + ATA_REG_LBA_LO, 0);
+    outb(channel->io + ATA_REG_LBA_MID, 0);
+    outb(channel->io + ATA_REG_LBA_HI, 0);
+    outb(channel->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    ata_delay(channel);
+
+    unsigned char status = inb(channel->io + ATA_REG_STATUS);
+    if (status == 0 || status == 0xFF) {
+        return -1;  // Nothing at this position
+    }
+
+    if (ata_wait_idle(channel) < 0) {
+        return -1;
+    }
+
+    // ATAPI and SATA devices abort IDENTIFY and leave a signature here
+    if (inb(channel->io + ATA_REG_LBA_MID) != 0 || inb(channel->io + ATA_REG_LBA_HI) != 0) {
+        return -1;
+    }
+
+    if (ata_wait_drq(channel) != 0) {
+        return -1;
+    }
+    insw(channel->io + ATA_REG_DATA, identify, 256);
+
+    // Words 60-61: sectors addressable with LBA28 (0 if LBA is unsupported)
+    unsigned int sectors = identify[60] | ((unsigned int)identify[61] << 16);
+    if (!(identify[49] & (1 << 9)) || sectors == 0) {
+        return -1;
+    }
+
+    drive->channel = channel;
+    drive->slave = slave;
+    drive->dma = (identify[49] & (1 << 8)) && channel->bmide != 0;
+    drive->sectors = (sectors > ATA_LBA28_LIMIT) ? ATA_LBA28_LIMIT : sectors;
+    drive->device = -1;
+    return 0;
+}
+
+/**
+ * Find the IDE controller and fill in the channel port bases
+ * Without a controller the legacy ports are still probed for PIO
+ */
+static void ata_setup_channels(void)
+{
+    pci_device_t pci;
+
+    g_ata_channels[0].io = ATA_PRIMARY_IO;
+    g_ata_channels[0].ctrl = ATA_PRIMARY_CTRL;
+    g_ata_channels[1].io = ATA_SECONDARY_IO;
+    g_ata_channels[1].ctrl = ATA_SECONDARY_CTRL;
+
+    if (pci_find_class(0x01, 0x01, 0, &pci) != 0) {
+        return;  // No IDE controller on the PCI bus
+    }
+
+    // Channels in native mode take their ports from BAR0-3
+    for (int c = 0; c < 2; c++) {
+        if (pci.prog_if & (1 << (c * 2))) {
+            unsigned int io = pci_read_bar(&pci, c * 2) & 0xFFFC;
+            unsigned int ctrl = pci_read_bar(&pci, c * 2 + 1) & 0xFFFC;
+            if (io != 0 && ctrl != 0) {
+                g_ata_channels[c].io = io;
+                g_ata_channels[c].ctrl = ctrl + 2;
+            }
+        }
+    }
+
+    // BAR4: bus-master registers, eight ports per channel
+    unsigned int bar4 = pci_read_bar(&pci, 4);
+    if (!(pci.prog_if & 0x80) || !(bar4 & 1) || (bar4 & 0xFFFC) == 0) {
+        return;  // No bus mastering (or it is memory mapped): PIO only
+    }
+
+    pci_enable_bus_master(&pci);
+    for (int c = 0; c < 2; c++) {
+        g_ata_channels[c].prdt = kmalloc_aligned(ATA_PRD_ENTRIES * sizeof(ata_prd_t), 64);
+        if (g_ata_channels[c].prdt != NULL) {
+            g_ata_channels[c].bmide = (bar4 & 0xFFFC) + c * 8;
+        }
+    }
+}
+
+/**
+ * Initialize ATA disks
+ * Probes master and slave on both channels and registers each disk
+ *
+ * @return: Number of disks registered
+ */
+int ata_init(void)
+{
+    if (g_ata_drive_count > 0) {
+        return g_ata_drive_count;  // Already initialized
+    }
+
+    ata_setup_channels();
+
+    for (int c = 0; c < 2; c++) {
+        ata_channel_t* channel = &g_ata_channels[c];
+
+        // A floating bus reads all ones: no drives on this channel
+        if (inb(channel->io + ATA_REG_STATUS) == 0xFF) {
+            continue;
+        }
+
+        // Polled operation: keep the drives from raising interrupts
+        outb(channel->ctrl, ATA_CTRL_NIEN);
+
+        for (unsigned char slave = 0; slave < 2; slave++) {
+            ata_drive_t* drive = &g_ata_drives[g_ata_drive_count];
+            if (ata_identify(channel, slave, drive) != 0) {
+                continue;
+            }
+
+            drive->device = block_register(&ata_driver, drive, drive->sectors);
+            if (drive->device >= 0) {
+                g_ata_drive_count++;
+            }
+        }
+    }
+
+    return g_ata_drive_count;
+}
@@ -1,82 +1,436 @@
 #include "block.h"
+#include "ramdisk.h"
+#include "ata.h"
+#include "virtio.h"
 #include "source.h"
+#include "io.h"
 
-// Global block device instance
-static block_device_t g_block_device;
+// Registered block devices
+static block_device_t g_block_devices[BLOCK_MAX_DEVICES];
+static int g_block_device_count = 0;
+
+// Device holding the file system (NULL until block_device_init)
+static block_device_t* g_root_device = NULL;
+
+// Request queue of the root device, sorted by block number
+static block_request_t* g_queue_head = NULL;
+static unsigned int g_queue_length = 0;
+static unsigned int g_queue_position = 0;  // Block after the last dispatched run
+
+/**
+ * Check a block range against a device
+ *
+ * @param dev: Device (can be NULL)
+ * @param start_block: First block
+ * @param count: Number of blocks
+ * @return: 1 if the whole range lies on the device, 0 otherwise
+ */
+static int block_range_ok(block_device_t* dev, unsigned int start_block, unsigned int count)
+{
+    return dev != NULL && count <= dev->total_blocks && start_block <= dev->total_blocks - count;
+}
+
+/**
+ * Register a block device
+ *
+ * @param driver: Operations for the device (must stay valid)
+ * @param driver_data: Driver's per-device state
+ * @param total_blocks: Device size in blocks
+ * @return: Device number, or -1 if the registry is full
+ */
+int block_register(const block_driver_t* driver, void* driver_data, unsigned int total_blocks)
+{
+    if (driver == NULL || driver->read == NULL || driver->write == NULL) {
+        return -1;  // Every device must at least read and write
+    }
+
+    if (g_block_device_count >= BLOCK_MAX_DEVICES) {
+        return -1;
+    }
+
+    block_device_t* dev = &g_block_devices[g_block_device_count];
+    dev->id = g_block_device_count;
+    dev->driver = driver;
+    dev->driver_data = driver_data;
+    dev->block_size = BLOCK_SIZE;
+    dev->total_blocks = total_blocks;
+    memset(&dev->stats, 0, sizeof(dev->stats));
+
+    return g_block_device_count++;
+}
+
+/**
+ * Look up a registered device
+ *
+ * @param id: Device number
+ * @return: Device, or NULL if no such device
+ */
+block_device_t* block_get_device(int id)
+{
+    if (id < 0 || id >= g_block_device_count) {
+        return NULL;
+    }
+    return &g_block_devices[id];
+}
+
+/**
+ * Get the number of registered devices
+ *
+ * @return: Device count
+ */
+int block_device_count(void)
+{
+    return g_block_device_count;
+}
+
+/**
+ * Zero the I/O statistics of every device
+ */
+void block_reset_stats(void)
+{
+    for (int i = 0; i < g_block_device_count; i++) {
+        memset(&g_block_devices[i].stats, 0, sizeof(g_block_devices[i].stats));
+    }
+}
+
+/**
+ * Record one driver call
+ *
+ * @param stats: Counters for the call's direction
+ * @param blocks: Blocks transferred
+ * @param cycles: Latency in timestamp-counter cycles
+ * @param result: Driver's return value
+ */
+static void block_account(block_io_stats_t* stats, unsigned int blocks, unsigned long long cycles, int result)
+{
+    unsigned int bucket = 0;
+    unsigned int clamped = (cycles >> 32) ? 0xFFFFFFFFu : (unsigned int)cycles;
+    for (unsigned int v = clamped >> (BLOCK_HIST_SHIFT + 1); v != 0 && bucket < BLOCK_HIST_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+
+    stats->ops++;
+    stats->blocks += blocks;
+    stats->errors += (result != 0);
+    stats->cycles += cycles;
+    if (clamped > stats->max_cycles) {
+        stats->max_cycles = clamped;
+    }
+    stats->histogram[bucket]++;
+}
+
+/**
+ * Call the root driver's read or write and account for it
+ *
+ * @param write: Non-zero to write, zero to read
+ * @param start_block: First block
+ * @param count: Number of blocks
+ * @param buffer: Data
+ * @return: Driver's result
+ */
+static int block_io(int write, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    block_device_t* dev = g_root_device;
+    unsigned long long start = rdtsc();
+
+    int result = write ? dev->driver->write(dev, start_block, count, buffer)
+                       : dev->driver->read(dev, start_block, count, buffer);
+
+    block_account(write ? &dev->stats.write : &dev->stats.read, count, rdtsc() - start, result);
+    return result;
+}
 
 /**
  * Initialize block device
- * Sets up the underlying storage (currently RAM disk)
- * 
+ * Probes for virtio and ATA disks and falls back to the boot RAM disk
+ * when there are none; the first registered device holds the file system
+ *
  * @return: 0 on success, -1 on error
  */
 int block_device_init(void)
 {
-    if (g_block_device.initialized) {
+    if (g_root_device != NULL) {
         return 0;  // Already initialized
     }
 
-    // Initialize RAM disk
-    if (ramdisk_init() != 0) {
+    // A persistent disk is preferred over the RAM disk, virtio first
+    if (g_block_device_count == 0) {
+        virtio_blk_init();
+        ata_init();
+    }
+
+    if (g_block_device_count == 0 && ramdisk_init() != 0) {
         return -1;
     }
 
-    // Set up block device structure
-    g_block_device.type = BLOCK_DEVICE_RAMDISK;
-    g_block_device.block_size = BLOCK_SIZE;
-    g_block_device.initialized = 1;
+    g_root_device = block_get_device(0);
+    return (g_root_device != NULL) ? 0 : -1;
+}
 
-    // Get disk information
-    ramdisk_get_info(NULL, &g_block_device.total_blocks);
+/**
+ * Fill in a request
+ *
+ * @param req: Request to fill in
+ * @param write: Non-zero to write, zero to read
+ * @param block: First block
+ * @param count: Number of blocks
+ * @param buffer: Data (count * BLOCK_SIZE bytes)
+ */
+void block_request_init(block_request_t* req, int write, unsigned int block, unsigned int count, unsigned char* buffer)
+{
+    req->block = block;
+    req->count = count;
+    req->buffer = buffer;
+    req->write = write;
+    req->status = BLOCK_REQ_IDLE;
+    req->next = NULL;
+}
+
+/**
+ * Check whether two requests touch a common block
+ *
+ * @param a: First request
+ * @param b: Second request
+ * @return: Non-zero if the block ranges overlap
+ */
+static int block_requests_overlap(block_request_t* a, block_request_t* b)
+{
+    return a->block < b->block + b->count && b->block < a->block + a->count;
+}
+
+/**
+ * Queue a request on the root device
+ *
+ * @param req: Request (must not already be pending)
+ * @return: 0 if queued, -1 on an invalid request
+ */
+int block_submit(block_request_t* req)
+{
+    if (req == NULL || req->status == BLOCK_REQ_PENDING || req->buffer == NULL || req->count == 0 ||
+        !block_range_ok(g_root_device, req->block, req->count)) {
+        return -1;
+    }
+
+    // Sorting must not reorder a write around an overlapping request
+    for (block_request_t* r = g_queue_head; r != NULL; r = r->next) {
+        if ((r->write || req->write) && block_requests_overlap(r, req)) {
+            block_poll();
+            break;
+        }
+    }
+
+    if (g_queue_length >= BLOCK_QUEUE_DEPTH) {
+        block_poll();
+    }
+
+    // Insert after requests with the same start block (FIFO among equals)
+    block_request_t** link = &g_queue_head;
+    while (*link != NULL && (*link)->block <= req->block) {
+        link = &(*link)->next;
+    }
+    req->next = *link;
+    *link = req;
+    req->status = BLOCK_REQ_PENDING;
+    g_queue_length++;
 
     return 0;
 }
 
+/**
+ * Transfer consecutive blocks held in several buffers
+ * Goes to the driver's readv/writev in one call when it has them;
+ * otherwise each run of contiguous buffers is one read/write call
+ *
+ * @param write: Non-zero to write, zero to read
+ * @param start_block: First block
+ * @param segments: Buffers in block order
+ * @param n: Number of segments
+ * @return: Number of driver calls made, or -1 on error
+ */
+static int block_transfer(int write, unsigned int start_block, block_segment_t* segments, unsigned int n)
+{
+    block_device_t* dev = g_root_device;
+    const block_driver_t* driver = dev->driver;
+    unsigned int i = 0;
+    int calls = 0;
+
+    if (n > 1 && (write ? driver->writev : driver->readv) != NULL) {
+        unsigned int count = 0;
+        for (i = 0; i < n; i++) {
+            count += segments[i].count;
+        }
+
+        unsigned long long start = rdtsc();
+        int result = write ? driver->writev(dev, start_block, segments, n)
+                           : driver->readv(dev, start_block, segments, n);
+        block_account(write ? &dev->stats.write : &dev->stats.read, count, rdtsc() - start, result);
+        return (result == 0) ? 1 : -1;
+    }
+
+    while (i < n) {
+        // Extend over segments whose buffers continue this one's
+        unsigned char* buffer = segments[i].buffer;
+        unsigned int count = segments[i].count;
+        for (i++; i < n && segments[i].buffer == buffer + count * BLOCK_SIZE; i++) {
+            count += segments[i].count;
+        }
+
+        if (block_io(write, start_block, count, buffer) != 0) {
+            return -1;
+        }
+        start_block += count;
+        calls++;
+    }
+
+    return calls;
+}
+
+/**
+ * Transfer a run of adjacent requests and complete them
+ *
+ * @param run: Requests in block order, all in the same direction
+ * @param n: Number of requests
+ */
+static void block_dispatch_run(block_request_t** run, unsigned int n)
+{
+    block_segment_t segments[BLOCK_MERGE_MAX];
+
+    for (unsigned int i = 0; i < n; i++) {
+        segments[i].buffer = run[i]->buffer;
+        segments[i].count = run[i]->count;
+    }
+
+    int calls = block_transfer(run[0]->write, run[0]->block, segments, n);
+    if (calls > 0) {
+        g_root_device->stats.merges += n - calls;
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        run[i]->status = (calls > 0) ? BLOCK_REQ_DONE : BLOCK_REQ_ERROR;
+    }
+}
+
+/**
+ * Dispatch queued requests
+ * C-LOOK: the sweep starts at the first request at or above the last
+ * dispatched position, runs up to the highest block, then wraps to the
+ * lowest
+ *
+ * @return: Number of requests completed
+ */
+int block_poll(void)
+{
+    block_request_t* run[BLOCK_MERGE_MAX];
+    int completed = 0;
+
+    if (g_queue_head == NULL) {
+        return 0;
+    }
+
+    // Rotate the sorted list so it starts at the sweep position
+    block_request_t* list = g_queue_head;
+    block_request_t** split = &g_queue_head;
+    while (*split != NULL && (*split)->block < g_queue_position) {
+        split = &(*split)->next;
+    }
+    if (*split != NULL && split != &g_queue_head) {
+        block_request_t** tail = split;
+        while (*tail != NULL) {
+            tail = &(*tail)->next;
+        }
+        list = *split;
+        *split = NULL;
+        *tail = g_queue_head;
+    }
+    g_queue_head = NULL;
+    g_queue_length = 0;
+
+    while (list != NULL) {
+        // Gather requests continuing the first one in the same direction
+        unsigned int n = 0;
+        unsigned int end = list->block;
+        do {
+            run[n++] = list;
+            end = list->block + list->count;
+            list = list->next;
+        } while (list != NULL && n < BLOCK_MERGE_MAX && list->write == run[0]->write && list->block == end);
+
+        block_dispatch_run(run, n);
+        g_queue_position = end;
+        completed += n;
+    }
+
+    return completed;
+}
+
+/**
+ * Wait for a request to complete
+ *
+ * @param req: Submitted request
+ * @return: 0 on success, -1 if the request failed
+ */
+int block_wait(block_request_t* req)
+{
+    if (req == NULL) {
+        return -1;
+    }
+
+    if (req->status == BLOCK_REQ_PENDING) {
+        block_poll();
+    }
+
+    return (req->status == BLOCK_REQ_DONE) ? 0 : -1;
+}
+
+/**
+ * Complete queued requests before a synchronous call touches the device
+ */
+static inline void block_drain(void)
+{
+    if (g_queue_head != NULL) {
+        block_poll();
+    }
+}
+
 /**
  * Read a block from the block device
- * 
+ *
  * @param block_num: Block number to read
  * @param buffer: Buffer to store data (must be at least block_size bytes)
  * @return: 0 on success, -1 on error
  */
 int block_read(unsigned int block_num, unsigned char* buffer)
 {
-    if (!g_block_device.initialized) {
+    if (!block_range_ok(g_root_device, block_num, 1) || buffer == NULL) {
         return -1;
     }
 
-    switch (g_block_device.type) {
-        case BLOCK_DEVICE_RAMDISK:
-            return ramdisk_read_block(block_num, buffer);
-        default:
-            return -1;
-    }
+    block_drain();
+
+    return block_io(0, block_num, 1, buffer);
 }
 
 /**
  * Write a block to the block device
- * 
+ *
  * @param block_num: Block number to write
  * @param buffer: Data to write (must be block_size bytes)
  * @return: 0 on success, -1 on error
  */
 int block_write(unsigned int block_num, unsigned char* buffer)
 {
-    if (!g_block_device.initialized) {
+    if (!block_range_ok(g_root_device, block_num, 1) || buffer == NULL) {
         return -1;
     }
 
-    switch (g_block_device.type) {
-        case BLOCK_DEVICE_RAMDISK:
-            return ramdisk_write_block(block_num, buffer);
-        default:
-            return -1;
-    }
+    block_drain();
+
+    return block_io(1, block_num, 1, buffer);
 }
 
 /**
  * Read multiple blocks from the block device
- * 
+ * The whole range goes to the driver in one call
+ *
  * @param start_block: Starting block number
  * @param count: Number of blocks to read
  * @param buffer: Buffer to store data
@@ -84,21 +438,19 @@ int block_write(unsigned int block_num, unsigned char* buffer)
  */
 int block_read_multiple(unsigned int start_block, unsigned int count, unsigned char* buffer)
 {
-    if (!g_block_device.initialized) {
+    if (!block_range_ok(g_root_device, start_block, count) || buffer == NULL) {
         return -1;
     }
 
-    switch (g_block_device.type) {
-        case BLOCK_DEVICE_RAMDISK:
-            return ramdisk_read_blocks(start_block, count, buffer);
-        default:
-            return -1;
-    }
+    block_drain();
+
+    return block_io(0, start_block, count, buffer);
 }
 
 /**
  * Write multiple blocks to the block device
- * 
+ * The whole range goes to the driver in one call
+ *
  * @param start_block: Starting block number
  * @param count: Number of blocks to write
  * @param buffer: Data to write
@@ -106,31 +458,195 @@ int block_read_multiple(unsigned int start_block, unsigned int count, unsigned c
  */
 int block_write_multiple(unsigned int start_block, unsigned int count, unsigned char* buffer)
 {
-    if (!g_block_device.initialized) {
+    if (!block_range_ok(g_root_device, start_block, count) || buffer == NULL) {
         return -1;
     }
 
-    switch (g_block_device.type) {
-        case BLOCK_DEVICE_RAMDISK:
-            return ramdisk_write_blocks(start_block, count, buffer);
-        default:
+    block_drain();
+
+    return block_io(1, start_block, count, buffer);
+}
+
+/**
+ * Transfer a list of blocks, one call per run of consecutive blocks
+ *
+ * @param write: Non-zero to write, zero to read
+ * @param vec: Blocks and their buffers
+ * @param count: Number of entries
+ * @return: 0 on success, -1 on error
+ */
+static int block_vec_transfer(int write, block_vec_t* vec, unsigned int count)
+{
+    block_segment_t segments[BLOCK_MERGE_MAX];
+
+    if (vec == NULL || g_root_device == NULL) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        if (!block_range_ok(g_root_device, vec[i].block, 1) || vec[i].buffer == NULL) {
             return -1;
+        }
+    }
+
+    block_drain();
+
+    unsigned int i = 0;
+    while (i < count) {
+        unsigned int start = vec[i].block;
+        unsigned int blocks = 0;
+        unsigned int n = 0;
+
+        // Gather the run, folding neighbouring buffers into one segment
+        while (i < count && vec[i].block == start + blocks) {
+            if (n > 0 && vec[i].buffer == segments[n - 1].buffer + segments[n - 1].count * BLOCK_SIZE) {
+                segments[n - 1].count++;
+            } else if (n < BLOCK_MERGE_MAX) {
+                segments[n].buffer = vec[i].buffer;
+                segments[n].count = 1;
+                n++;
+            } else {
+                break;
+            }
+            blocks++;
+            i++;
+        }
+
+        int calls = block_transfer(write, start, segments, n);
+        if (calls < 0) {
+            return -1;
+        }
+        g_root_device->stats.merges += blocks - calls;
+    }
+
+    return 0;
+}
+
+/**
+ * Read a list of blocks into their buffers
+ *
+ * @param vec: Blocks and their buffers
+ * @param count: Number of entries
+ * @return: 0 on success, -1 on error
+ */
+int block_readv(block_vec_t* vec, unsigned int count)
+{
+    return block_vec_transfer(0, vec, count);
+}
+
+/**
+ * Write a list of blocks from their buffers
+ *
+ * @param vec: Blocks and their buffers
+ * @param count: Number of entries
+ * @return: 0 on success, -1 on error
+ */
+int block_writev(block_vec_t* vec, unsigned int count)
+{
+    return block_vec_transfer(1, vec, count);
+}
+
+/**
+ * Flush completed writes to stable storage
+ * Devices without a flush operation have nothing to flush
+ *
+ * @return: 0 on success, -1 on error
+ */
+int block_flush(void)
+{
+    if (g_root_device == NULL) {
+        return -1;
+    }
+
+    block_drain();
+    g_root_device->stats.flushes++;
+
+    if (g_root_device->driver->flush == NULL) {
+        return 0;
+    }
+
+    return g_root_device->driver->flush(g_root_device);
+}
+
+/**
+ * Discard a range of blocks
+ * Discard is a hint, so devices without it succeed without doing anything
+ *
+ * @param start_block: First block to discard
+ * @param count: Number of blocks
+ * @return: 0 on success, -1 on error
+ */
+int block_discard(unsigned int start_block, unsigned int count)
+{
+    if (!block_range_ok(g_root_device, start_block, count)) {
+        return -1;
+    }
+
+    block_drain();
+
+    g_root_device->stats.discards++;
+
+    if (g_root_device->driver->discard == NULL) {
+        return 0;
+    }
+
+    return g_root_device->driver->discard(g_root_device, start_block, count);
+}
+
+/**
+ * Map a block for direct access
+ *
+ * @param block_num: Block number to map
+ * @param write: Non-zero if the caller will overwrite the whole block
+ * @param ptr: Pointer to store the block's address
+ * @return: 0 on success, -1 if the block cannot be mapped
+ */
+int block_map(unsigned int block_num, int write, unsigned char** ptr)
+{
+    if (!block_range_ok(g_root_device, block_num, 1) || ptr == NULL) {
+        return -1;
+    }
+
+    block_drain();
+
+    if (g_root_device->driver->map == NULL) {
+        return -1;
+    }
+
+    // *ptr is left alone on failure (the buffer cache maps into b->data)
+    unsigned char* mapped = g_root_device->driver->map(g_root_device, block_num, write);
+    if (mapped == NULL) {
+        return -1;
+    }
+    *ptr = mapped;
+
+    g_root_device->stats.maps++;
+    return 0;
+}
+
+/**
+ * Release a block mapped with block_map
+ *
+ * @param block_num: Block number that was mapped
+ */
+void block_unmap(unsigned int block_num)
+{
+    if (g_root_device != NULL && g_root_device->driver->unmap != NULL) {
+        g_root_device->driver->unmap(g_root_device, block_num);
     }
 }
 
 /**
  * Get block device information
- * 
+ *
  * @param block_size: Pointer to store block size (can be NULL)
  * @param total_blocks: Pointer to store total blocks (can be NULL)
  */
 void block_get_info(unsigned int* block_size, unsigned int* total_blocks)
 {
     if (block_size != NULL) {
-        *block_size = g_block_device.block_size;
+        *block_size = g_root_device ? g_root_device->block_size : 0;
     }
     if (total_blocks != NULL) {
-        *total_blocks = g_block_device.total_blocks;
+        *total_blocks = g_root_device ? g_root_device->total_blocks : 0;
     }
 }
-
@@ -1,9 +1,13 @@
 bits 32
 
+MBALIGN  equ 1 << 0              ; Align loaded modules on page boundaries
+MEMINFO  equ 1 << 1              ; Provide memory map
+FLAGS    equ MBALIGN | MEMINFO
+
 section .multiboot               ; Multiboot header
         dd 0x1BADB002            ; Magic number for bootloader
-        dd 0x0                   ; Flags
-        dd - (0x1BADB002 + 0x0)  ; Checksum
+        dd FLAGS                 ; Flags
+        dd - (0x1BADB002 + FLAGS) ; Checksum
 
 section .text
 global start
@@ -12,6 +16,8 @@ extern main                      ; main function in C
 start:
         cli                      ; Disable interrupts
         mov esp, stack_space     ; Initialize stack pointer
+        push ebx                 ; Multiboot info structure
+        push eax                 ; Multiboot magic
         call main                ; Call C main
         hlt                      ; Halt CPU
 
@@ -1,13 +1,25 @@
 #include "buffer.h"
+#include "malloc.h"
 #include "source.h"
 
 // Buffer cache pool
-static buf_t bufs[NBUF];
+// Headers are one array; the block data they point to is a separate
+// page-aligned slab, so hash and LRU walks never touch block data
+static buf_t* bufs = NULL;
+static unsigned char* buf_data = NULL;
+static unsigned int nbuf = 0;
 static int buffer_initialized = 0;
 
-// Simple hash table for buffers (by block number)
-#define HASH_SIZE 8
-static buf_t* hash_table[HASH_SIZE];
+// Hash table for buffers (by block number), a power of two in size
+static buf_t** hash_table = NULL;
+static unsigned int hash_mask = 0;
+
+// Cache statistics
+static buffer_stats_t g_buffer_stats;
+
+// Unreferenced buffers, most recently released first
+// lru.lru_next is the most recently used, lru.lru_prev the eviction victim
+static buf_t lru;
 
 /**
  * Hash function for block numbers
@@ -17,12 +29,86 @@ static buf_t* hash_table[HASH_SIZE];
  */
 static unsigned int hash(unsigned int blockno)
 {
-    return blockno % HASH_SIZE;
+    return blockno & hash_mask;
+}
+
+/**
+ * Unlink a buffer from the LRU list
+ *
+ * @param b: Buffer on the list
+ */
+static void lru_remove(buf_t* b)
+{
+    b->lru_prev->lru_next = b->lru_next;
+    b->lru_next->lru_prev = b->lru_prev;
+    b->lru_prev = NULL;
+    b->lru_next = NULL;
+}
+
+/**
+ * Put a buffer at the most recently used end of the LRU list
+ *
+ * @param b: Buffer not on the list
+ */
+static void lru_push_front(buf_t* b)
+{
+    b->lru_next = lru.lru_next;
+    b->lru_prev = &lru;
+    lru.lru_next->lru_prev = b;
+    lru.lru_next = b;
+}
+
+/**
+ * Put a buffer at the eviction end of the LRU list
+ *
+ * @param b: Buffer not on the list
+ */
+static void lru_push_back(buf_t* b)
+{
+    b->lru_prev = lru.lru_prev;
+    b->lru_next = &lru;
+    lru.lru_prev->lru_next = b;
+    lru.lru_prev = b;
+}
+
+/**
+ * Allocate headers, data and hash table for a cache of a given size
+ *
+ * @param count: Number of buffers
+ * @return: 0 on success, -1 if out of memory (nothing is kept)
+ */
+static int buffer_alloc(unsigned int count)
+{
+    // About one buffer per bucket keeps chains short
+    unsigned int buckets = 1;
+    while (buckets < count) {
+        buckets <<= 1;
+    }
+
+    buf_t* headers = (buf_t*)kmalloc_aligned(count * sizeof(buf_t), CACHE_LINE_SIZE);
+    unsigned char* data = (unsigned char*)kmalloc_pages((count * BLOCK_SIZE + PAGE_SIZE - 1) / PAGE_SIZE);
+    buf_t** table = (buf_t**)kmalloc(buckets * sizeof(buf_t*));
+    if (headers == NULL || data == NULL || table == NULL) {
+        if (headers != NULL) kfree(headers);
+        if (data != NULL) kfree_pages(data);
+        if (table != NULL) kfree(table);
+        return -1;
+    }
+
+    bufs = headers;
+    buf_data = data;
+    nbuf = count;
+    hash_table = table;
+    hash_mask = buckets - 1;
+    return 0;
 }
 
 /**
  * Initialize buffer cache
- * Sets up the buffer pool and hash table
+ * Sizes the pool from free physical memory (a share of it, within
+ * BUF_MIN..BUF_MAX and no larger than the root device), then sets up the
+ * buffers and hash table
+ * Block data is page aligned, so no block straddles a cache line
  */
 void buffer_init(void)
 {
@@ -30,32 +116,153 @@ void buffer_init(void)
         return;
     }
 
-    // Initialize all buffers
-    for (int i = 0; i < NBUF; i++) {
-        bufs[i].valid = 0;
-        bufs[i].disk = 0;
+    if (bufs == NULL) {
+        unsigned int free_pages, total_blocks;
+        pmm_get_info(NULL, &free_pages);
+        block_get_info(NULL, &total_blocks);
+
+        unsigned int count = free_pages / BUF_MEMORY_SHARE * (PAGE_SIZE / BLOCK_SIZE);
+        if (count > BUF_MAX) count = BUF_MAX;
+        if (count > total_blocks) count = total_blocks;
+        if (count < BUF_MIN) count = BUF_MIN;
+
+        // Fall back to smaller caches when memory is short
+        while (buffer_alloc(count) != 0) {
+            if (count == BUF_MIN) {
+                return;  // Out of memory - cache stays unusable
+            }
+            count /= 2;
+            if (count < BUF_MIN) count = BUF_MIN;
+        }
+    }
+
+    // Initialize all buffers, all of them free
+    lru.lru_next = &lru;
+    lru.lru_prev = &lru;
+    for (unsigned int i = 0; i < nbuf; i++) {
         bufs[i].blockno = 0;
         bufs[i].next = NULL;
+        bufs[i].store = buf_data + i * BLOCK_SIZE;
+        bufs[i].data = bufs[i].store;
+        bufs[i].valid = 0;
+        bufs[i].dirty = 0;
+        bufs[i].mapped = 0;
+        bufs[i].refcnt = 0;
+        block_request_init(&bufs[i].req, 0, 0, 0, NULL);
+        lru_push_back(&bufs[i]);
     }
 
     // Initialize hash table
-    for (int i = 0; i < HASH_SIZE; i++) {
+    for (unsigned int i = 0; i <= hash_mask; i++) {
         hash_table[i] = NULL;
     }
 
+    buffer_reset_stats();
+    g_buffer_stats.buffers = nbuf;
+    g_buffer_stats.hash_buckets = hash_mask + 1;
     buffer_initialized = 1;
 }
 
 /**
- * Find buffer in cache by block number
- * 
+ * Get buffer cache statistics
+ *
+ * @param stats: Structure to fill
+ */
+void buffer_get_stats(buffer_stats_t* stats)
+{
+    if (stats != NULL) {
+        *stats = g_buffer_stats;
+    }
+}
+
+/**
+ * Zero the buffer cache counters (sizes are kept)
+ */
+void buffer_reset_stats(void)
+{
+    g_buffer_stats.hits = 0;
+    g_buffer_stats.misses = 0;
+    g_buffer_stats.evictions = 0;
+    g_buffer_stats.writebacks = 0;
+    g_buffer_stats.readahead = 0;
+}
+
+/**
+ * Unlink a buffer from its hash chain
+ *
+ * @param b: Buffer currently in the hash table
+ */
+static void hash_remove(buf_t* b)
+{
+    buf_t** link = &hash_table[hash(b->blockno)];
+    while (*link != NULL && *link != b) {
+        link = &(*link)->next;
+    }
+    if (*link != NULL) {
+        *link = b->next;
+    }
+    b->next = NULL;
+}
+
+/**
+ * Account for a buffer's finished write
+ * A buffer stays dirty while its write is queued; only a write that
+ * completed successfully makes it clean. Anything that marks the buffer
+ * dirty again calls this first, so a write of older contents never
+ * clears a newer change.
+ *
+ * @param b: Buffer
+ * @return: 0 if no write failed, -1 if the last write failed (the buffer stays dirty)
+ */
+static int bcomplete(buf_t* b)
+{
+    if (!b->req.write || b->req.status == BLOCK_REQ_IDLE || b->req.status == BLOCK_REQ_PENDING) {
+        return 0;
+    }
+
+    int failed = (b->req.status != BLOCK_REQ_DONE);
+    if (!failed) {
+        b->dirty = 0;
+    }
+    b->req.status = BLOCK_REQ_IDLE;
+    return failed ? -1 : 0;
+}
+
+/**
+ * Write a dirty buffer back and wait for it
+ *
+ * @param b: Buffer that is not queued
+ * @return: 0 on success, -1 on error (the buffer stays dirty)
+ */
+static int bwriteback(buf_t* b)
+{
+    block_request_init(&b->req, 1, b->blockno, 1, b->data);
+    if (block_submit(&b->req) != 0) {
+        return -1;
+    }
+    block_wait(&b->req);
+    g_buffer_stats.writebacks++;
+    return bcomplete(b);
+}
+
+/**
+ * Get a referenced buffer for a block
+ * Returns the cached buffer if there is one; otherwise recycles the least
+ * recently released unreferenced buffer, writing it back first if dirty.
+ * A buffer whose writeback fails is kept (moved to the most recently used
+ * end) and the next candidate is tried.
+ *
  * @param blockno: Block number to find
- * @return: Pointer to buffer if found, NULL otherwise
+ * @return: Pointer to buffer, or NULL if every buffer is in use or none
+ *          could be written back
  */
 static buf_t* bget(unsigned int blockno)
 {
     if (!buffer_initialized) {
         buffer_init();
+        if (!buffer_initialized) {
+            return NULL;
+        }
     }
 
     // Search hash chain
@@ -63,61 +270,228 @@ static buf_t* bget(unsigned int blockno)
     buf_t* b = hash_table[h];
 
     while (b != NULL) {
-        if (b->blockno == blockno && b->valid) {
-            return b;  // Found in cache
+        if (b->blockno == blockno) {
+            // Found in cache - take it off the free list while in use
+            if (b->refcnt++ == 0) {
+                lru_remove(b);
+            }
+            return b;
         }
         b = b->next;
     }
 
-    // Not in cache - find a free buffer
-    for (int i = 0; i < NBUF; i++) {
-        if (!bufs[i].valid) {
-            // Use this buffer
-            bufs[i].valid = 1;
-            bufs[i].disk = 0;
-            bufs[i].blockno = blockno;
-            
-            // Add to hash chain
-            bufs[i].next = hash_table[h];
-            hash_table[h] = &bufs[i];
-            
-            return &bufs[i];
-        }
-    }
-
-    // No free buffer - use first one (simple eviction)
-    // In a real system, you'd use LRU or similar
-    buf_t* victim = &bufs[0];
-    
-    // Remove from hash chain
-    unsigned int victim_hash = hash(victim->blockno);
-    if (hash_table[victim_hash] == victim) {
-        hash_table[victim_hash] = victim->next;
-    } else {
-        buf_t* prev = hash_table[victim_hash];
-        while (prev != NULL && prev->next != victim) {
-            prev = prev->next;
+    // Not in cache - recycle the least recently released buffer
+    buf_t* victim = NULL;
+    for (unsigned int tries = 0; tries < nbuf && victim == NULL; tries++) {
+        buf_t* candidate = lru.lru_prev;
+        if (candidate == &lru) {
+            return NULL;  // Every buffer is referenced
         }
-        if (prev != NULL) {
-            prev->next = victim->next;
+
+        // Mapped blocks are already on the device; others are written back if dirty
+        if (candidate->mapped) {
+            block_unmap(candidate->blockno);
+            victim = candidate;
+            continue;
         }
-    }
 
-    // Write back if dirty
-    if (victim->disk) {
-        block_write(victim->blockno, victim->data);
+        // The queued write (if any) still reads from this buffer
+        if (candidate->req.status == BLOCK_REQ_PENDING) {
+            block_wait(&candidate->req);
+        }
+        bcomplete(candidate);
+        if (candidate->dirty && bwriteback(candidate) != 0) {
+            // Keep the only copy of the data and move on to another buffer
+            lru_remove(candidate);
+            lru_push_front(candidate);
+            continue;
+        }
+        victim = candidate;
     }
+    if (victim == NULL) {
+        return NULL;  // No buffer could be written back
+    }
+    lru_remove(victim);
+    if (victim->valid) {
+        g_buffer_stats.evictions++;
+    }
+
+    // Remove from hash chain (unused and invalidated buffers are not on one)
+    hash_remove(victim);
 
     // Reuse buffer
-    victim->valid = 1;
-    victim->disk = 0;
+    victim->data = victim->store;
+    victim->mapped = 0;
+    victim->valid = 0;
+    victim->dirty = 0;
+    block_request_init(&victim->req, 0, 0, 0, NULL);
     victim->blockno = blockno;
+    victim->refcnt = 1;
     victim->next = hash_table[h];
     hash_table[h] = victim;
 
     return victim;
 }
 
+/**
+ * Read a run of consecutive blocks in one device call
+ * Drivers without readv get the run through a contiguous staging buffer,
+ * since the buffers' data slots are scattered over the slab
+ *
+ * @param vec: Blocks (consecutive numbers) and their buffers
+ * @param count: Number of entries
+ * @return: 0 on success, -1 on error
+ */
+static int bread_run(block_vec_t* vec, unsigned int count)
+{
+    block_device_t* dev = block_get_device(0);
+    if (count == 1 || dev->driver->readv != NULL) {
+        return block_readv(vec, count);
+    }
+
+    unsigned char* staging = (unsigned char*)kmalloc(count * BLOCK_SIZE);
+    if (staging == NULL) {
+        return block_readv(vec, count);
+    }
+
+    int result = block_read_multiple(vec[0].block, count, staging);
+    if (result == 0) {
+        for (unsigned int i = 0; i < count; i++) {
+            memcpy(vec[i].buffer, staging + i * BLOCK_SIZE, BLOCK_SIZE);
+        }
+    }
+    kfree(staging);
+    return result;
+}
+
+/**
+ * Prefetch blocks into the cache
+ * Each missing block gets a buffer; runs of consecutive blocks are then
+ * read with one device call each
+ *
+ * @param blocks: Block numbers
+ * @param count: Number of entries
+ */
+void breadahead(unsigned int* blocks, unsigned int count)
+{
+    if (blocks == NULL || count == 0) {
+        return;
+    }
+    if (count > BUF_READAHEAD_MAX) {
+        count = BUF_READAHEAD_MAX;
+    }
+
+    // Devices that map blocks load them on demand without any I/O
+    block_device_t* dev = block_get_device(0);
+    if (dev == NULL || dev->driver->map != NULL) {
+        return;
+    }
+
+    buf_t* loading[BUF_READAHEAD_MAX];
+    block_vec_t vec[BUF_READAHEAD_MAX];
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (bfind(blocks[i]) != NULL) {
+            continue;  // Already cached
+        }
+
+        buf_t* b = bget(blocks[i]);
+        if (b == NULL) {
+            break;  // Every buffer is in use
+        }
+        if (b->refcnt > 1) {
+            brelse(b);  // Listed twice - already being loaded
+            continue;
+        }
+
+        loading[n] = b;
+        vec[n].block = blocks[i];
+        vec[n].buffer = b->data;
+        n++;
+    }
+
+    // Blocks that fail to load are dropped; bread retries them
+    for (unsigned int i = 0; i < n; ) {
+        unsigned int run = 1;
+        while (i + run < n && vec[i + run].block == vec[i].block + run) {
+            run++;
+        }
+
+        int ok = (bread_run(&vec[i], run) == 0);
+        for (unsigned int j = i; j < i + run; j++) {
+            if (ok) {
+                loading[j]->valid = 1;
+                g_buffer_stats.readahead++;
+            } else {
+                hash_remove(loading[j]);
+            }
+            brelse(loading[j]);
+        }
+        i += run;
+    }
+}
+
+/**
+ * Find a cached block without doing any I/O
+ * The buffer is not referenced; use bread to hold it
+ *
+ * @param blockno: Block number
+ * @return: Buffer holding the block's contents, or NULL if not cached
+ */
+buf_t* bfind(unsigned int blockno)
+{
+    if (!buffer_initialized) {
+        return NULL;
+    }
+
+    for (buf_t* b = hash_table[hash(blockno)]; b != NULL; b = b->next) {
+        if (b->blockno == blockno && b->valid) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Drop a block from the cache
+ * Used when the block is freed, so stale contents are never served;
+ * unwritten changes are discarded
+ *
+ * @param blockno: Block number
+ */
+void binvalidate(unsigned int blockno)
+{
+    if (!buffer_initialized) {
+        return;
+    }
+
+    for (buf_t* b = hash_table[hash(blockno)]; b != NULL; b = b->next) {
+        if (b->blockno != blockno) {
+            continue;
+        }
+
+        if (b->mapped) {
+            block_unmap(b->blockno);
+        } else if (b->req.status == BLOCK_REQ_PENDING) {
+            block_wait(&b->req);
+        }
+
+        hash_remove(b);
+        b->data = b->store;
+        b->mapped = 0;
+        b->valid = 0;
+        b->dirty = 0;
+        block_request_init(&b->req, 0, 0, 0, NULL);
+
+        // An unreferenced slot is now the first to be recycled
+        if (b->refcnt == 0) {
+            lru_remove(b);
+            lru_push_back(b);
+        }
+        return;
+    }
+}
+
 /**
  * Get buffer for a block (read from disk if not cached)
  * 
@@ -131,18 +505,46 @@ buf_t* bread(unsigned int blockno)
         return NULL;
     }
 
-    // If not already loaded, read from disk
-    if (!b->disk) {
-        if (block_read(blockno, b->data) != 0) {
-            b->valid = 0;
-            return NULL;
+    // If not already loaded, map the block (no copy) or read it from disk.
+    // A block with no data yet is not mapped, so reading it stays free;
+    // if it is then modified, its writeback gives it storage.
+    if (b->valid) {
+        g_buffer_stats.hits++;
+    } else {
+        g_buffer_stats.misses++;
+        if (block_map(blockno, 0, &b->data) == 0) {
+            b->mapped = 1;
+        } else {
+            block_request_init(&b->req, 0, blockno, 1, b->data);
+            if (block_submit(&b->req) != 0 || block_wait(&b->req) != 0) {
+                hash_remove(b);
+                brelse(b);
+                return NULL;
+            }
         }
-        b->disk = 1;  // Mark as loaded from disk
+        b->valid = 1;  // Mark as loaded from disk
     }
 
     return b;
 }
 
+/**
+ * Mark a buffer as modified
+ * The block is written back when the buffer is evicted or flushed
+ *
+ * @param b: Pointer to buffer
+ */
+void bdirty(buf_t* b)
+{
+    // Mapped buffers are the disk block itself
+    if (b == NULL || !b->valid || b->mapped) {
+        return;
+    }
+
+    bcomplete(b);
+    b->dirty = 1;
+}
+
 /**
  * Write buffer to disk
  * 
@@ -154,22 +556,82 @@ void bwrite(buf_t* b)
         return;
     }
 
-    // Write to disk
-    if (block_write(b->blockno, b->data) == 0) {
-        b->disk = 1;  // Mark as synced with disk
+    // Mapped buffers are the disk block itself
+    if (b->mapped) {
+        return;
+    }
+
+    // The buffer is clean only once its write has completed
+    bcomplete(b);
+    b->dirty = 1;
+
+    // A write still queued picks up the new contents when it is dispatched
+    if (b->req.status == BLOCK_REQ_PENDING && b->req.write) {
+        return;
+    }
+
+    // Queue the write; fall back to writing now if it cannot be queued
+    g_buffer_stats.writebacks++;
+    block_request_init(&b->req, 1, b->blockno, 1, b->data);
+    if (block_submit(&b->req) != 0 && block_write(b->blockno, b->data) == 0) {
+        b->dirty = 0;  // Mark as synced with disk
+    }
+}
+
+/**
+ * Write every dirty buffer back and flush the device
+ * The writes are queued together so the elevator can merge neighbouring
+ * blocks; a buffer whose write fails stays dirty
+ *
+ * @return: 0 on success, -1 if any write or the flush failed
+ */
+int bflush(void)
+{
+    int result = 0;
+
+    if (buffer_initialized) {
+        for (unsigned int i = 0; i < nbuf; i++) {
+            if (bufs[i].dirty) {
+                bwrite(&bufs[i]);
+            }
+        }
+
+        block_poll();
+
+        // A failed write leaves its buffer dirty
+        for (unsigned int i = 0; i < nbuf; i++) {
+            if (bcomplete(&bufs[i]) != 0) {
+                result = -1;
+            }
+        }
+    }
+
+    if (block_flush() != 0) {
+        result = -1;
     }
+    return result;
 }
 
 /**
  * Release buffer
- * Makes buffer available for reuse (doesn't write to disk)
+ * Drops a reference; once unreferenced the buffer becomes the most
+ * recently used candidate for reuse (doesn't write to disk)
  * 
  * @param b: Pointer to buffer
  */
 void brelse(buf_t* b)
 {
-    // In this simplified version, we don't do anything
-    // In a real system, this would update LRU, unlock, etc.
-    // For now, buffers stay in cache until evicted
+    if (b == NULL || b->refcnt <= 0) {
+        return;
+    }
+
+    if (--b->refcnt == 0) {
+        // Failed reads and invalidated blocks are recycled first
+        if (b->valid) {
+            lru_push_front(b);
+        } else {
+            lru_push_back(b);
+        }
+    }
 }
 
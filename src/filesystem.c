@@ -1,7 +1,8 @@
 #include "filesystem.h"
 #include "source.h"
 #include "inode.h"
-#include "malloc.h"
+#include "buffer.h"
+#include "arena.h"
 
 // Global file system state
 char current_path[MAX_COMMAND_LENGTH];
@@ -149,18 +150,21 @@ static int split_path(char* path, unsigned int* parent_inum, char* name)
 }
 
 // Initialize the file system
-void filesystem_init()
+// Returns 0 on success, -1 if no file system could be mounted
+int filesystem_init()
 {
     strcpy(current_path, "/");
     
     // Initialize Xv6-style file system
     if (fs_xv6_init() != 0) {
-        // Failed to initialize - this is a problem
-        return;
+        // No usable file system - every path lookup fails
+        root_inum = 0;
+        return -1;
     }
 
     // Root directory is inode 1 (created by fs_xv6_init)
     root_inum = 1;
+    return 0;
 }
 
 // Initialize file system
@@ -221,9 +225,7 @@ int fs_create_directory(char* path)
     strncpy(dotdot_entry.name, "..", DIRSIZ);
 
     char dir_data[BLOCK_SIZE];
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        dir_data[i] = 0;
-    }
+    memset(dir_data, 0, BLOCK_SIZE);
     
     dirent_t* entries = (dirent_t*)dir_data;
     entries[0] = dot_entry;
@@ -353,7 +355,10 @@ int fs_delete_directory(char* path)
     }
 
     // Check if directory is empty (only . and .. should be present)
-    char dir_data[BLOCK_SIZE * 12];
+    char* dir_data = (char*)arena_alloc(&scratch_arena, dir_ip.dinode.size);
+    if (dir_data == NULL) {
+        return 0;
+    }
     int bytes_read = readi(&dir_ip, dir_data, 0, dir_ip.dinode.size);
     if (bytes_read < 0) {
         return 0;
@@ -403,12 +408,8 @@ int fs_delete_file(char* path)
         return 0;  // Not a file
     }
 
-    // Free all data blocks
-    for (int i = 0; i < 12; i++) {
-        if (file_ip.dinode.addrs[i] != 0) {
-            bfree(file_ip.dinode.addrs[i]);
-        }
-    }
+    // Free all data blocks (and let the device drop their contents)
+    bfree_blocks(file_ip.dinode.addrs, 12);
 
     // Free the inode
     ifree(file_inum);
@@ -449,9 +450,12 @@ int fs_write_file(char* path, char* content)
         unsigned int new_blocks = (new_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
         
         // Free blocks beyond the new size
-        for (unsigned int i = new_blocks; i < old_blocks && i < 12; i++) {
-            if (file_ip.dinode.addrs[i] != 0) {
-                bfree(file_ip.dinode.addrs[i]);
+        if (old_blocks > 12) {
+            old_blocks = 12;
+        }
+        if (new_blocks < old_blocks) {
+            bfree_blocks(&file_ip.dinode.addrs[new_blocks], old_blocks - new_blocks);
+            for (unsigned int i = new_blocks; i < old_blocks; i++) {
                 file_ip.dinode.addrs[i] = 0;
             }
         }
@@ -501,7 +505,8 @@ char* fs_read_file(char* path)
         return NULL;
     }
 
-    char* buffer = (char*)kmalloc(file_size + 1);
+    // Per-command temporary: released when the shell command finishes
+    char* buffer = (char*)arena_alloc(&scratch_arena, file_size + 1);
     if (buffer == NULL) {
         return NULL;  // Out of memory
     }
@@ -509,7 +514,6 @@ char* fs_read_file(char* path)
     // Read file content
     int bytes_read = readi(&file_ip, buffer, 0, file_size);
     if (bytes_read < 0) {
-        kfree(buffer);
         return NULL;
     }
 
@@ -540,7 +544,10 @@ int fs_list_directory(char* path, directory_t* result)
     }
 
     // Read directory entries
-    char dir_data[BLOCK_SIZE * 12];
+    char* dir_data = (char*)arena_alloc(&scratch_arena, dir_ip.dinode.size);
+    if (dir_data == NULL) {
+        return 0;
+    }
     int bytes_read = readi(&dir_ip, dir_data, 0, dir_ip.dinode.size);
     if (bytes_read < 0) {
         return 0;
@@ -637,8 +644,8 @@ int fs_format()
 // Save to memory
 int fs_save_to_memory()
 {
-    // With inode-based FS, data is already in RAM disk
-    return 1;
+    // Write back cached blocks and make them durable
+    return bflush() == 0;
 }
 
 // Load from memory
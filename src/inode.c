@@ -4,21 +4,41 @@
 #include "block.h"
 
 // File system layout constants
+// Layout: superblock | bitmap blocks | inode table | data blocks
+// Bitmap and inode table are sized from the disk at format time
 #define SUPERBLOCK_BLOCK    0   // Superblock is at block 0
 #define BITMAP_BLOCK        1   // Bitmap starts at block 1
-#define INODE_TABLE_BLOCK   2   // Inode table starts at block 2
-#define DATA_BLOCK_START    10  // Data blocks start here (after superblock, bitmap, inodes)
-
-// Number of blocks for bitmap (1 bit per data block)
-#define BITMAP_BLOCKS       1   // Simplified: 1 block = 4096 data blocks max
-
-// Number of inodes (simplified)
-#define NINODES             64  // 64 inodes should be enough for learning
+#define BITS_PER_BLOCK      (BLOCK_SIZE * 8)  // Data blocks tracked per bitmap block
+
+// Number of inodes
+#define NINODES             64     // Minimum, enough for small disks
+#define BLOCKS_PER_INODE    16     // Larger disks get one inode per 16 blocks (8KB)
+#define MAX_INODES          65535  // dirent_t.inum is 16 bits
+
+// Sequential readahead
+#define READAHEAD_MIN       2      // Window after the first sequential read (blocks)
+#define READAHEAD_MAX       8      // Largest window
+#define READAHEAD_SLOTS     16     // Inodes whose access pattern is tracked at once
+
+// Readahead state for one inode
+typedef struct {
+    unsigned int inum;         // Inode tracked in this slot (0 = none)
+    unsigned int next_offset;  // Where a sequential read would start
+    unsigned int window;       // Blocks prefetched past the current read
+    unsigned int ahead_end;    // First logical block not yet prefetched
+} readahead_t;
 
 // Global superblock (cached in memory)
 static superblock_t g_superblock;
 static int superblock_loaded = 0;
 
+// Set by the format boot option: a blank persistent disk may be formatted
+static int format_requested = 0;
+
+// Readahead slots, indexed by inode number
+static readahead_t g_readahead[READAHEAD_SLOTS];
+static int readahead_enabled = 0;
+
 /**
  * Read superblock from disk
  * 
@@ -30,14 +50,14 @@ int get_superblock(superblock_t* sb)
     if (sb == NULL) return -1;
 
     // Read superblock from block 0
-    unsigned char block[BLOCK_SIZE];
-    if (block_read(SUPERBLOCK_BLOCK, block) != 0) {
+    buf_t* b = bread(SUPERBLOCK_BLOCK);
+    if (b == NULL) {
         return -1;
     }
 
     // Copy superblock data
-    superblock_t* disk_sb = (superblock_t*)block;
-    *sb = *disk_sb;
+    *sb = *(superblock_t*)b->data;
+    brelse(b);
 
     // Cache it
     g_superblock = *sb;
@@ -56,29 +76,38 @@ static int put_superblock(superblock_t* sb)
 {
     if (sb == NULL) return -1;
 
-    unsigned char block[BLOCK_SIZE];
-    
-    // Zero out block first
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        block[i] = 0;
+    buf_t* b = bread(SUPERBLOCK_BLOCK);
+    if (b == NULL) {
+        return -1;
     }
 
-    // Copy superblock data
-    superblock_t* disk_sb = (superblock_t*)block;
-    *disk_sb = *sb;
+    // Zero out block first, then copy superblock data
+    memset(b->data, 0, BLOCK_SIZE);
+    *(superblock_t*)b->data = *sb;
 
     // Write to block 0
-    if (block_write(SUPERBLOCK_BLOCK, block) != 0) {
-        return -1;
-    }
+    bdirty(b);
+    brelse(b);
 
     g_superblock = *sb;
     return 0;
 }
 
+/**
+ * Allow formatting a persistent disk that holds no file system
+ *
+ * @param enabled: Non-zero to format
+ */
+void fs_set_format(int enabled)
+{
+    format_requested = enabled;
+}
+
 /**
  * Initialize the file system
- * Creates superblock and initializes structures
+ * Mounts an existing file system, or creates one on a RAM disk. A
+ * persistent disk without one is left alone unless formatting was
+ * requested, so a disk holding other data is never overwritten
  * 
  * @return: 0 on success, -1 on error
  */
@@ -89,6 +118,13 @@ int fs_xv6_init(void)
         return -1;
     }
 
+    // Initialize buffer cache (a file system found on disk uses it too)
+    buffer_init();
+
+    // Blocks a device can map cost no I/O, so only other devices read ahead
+    block_device_t* root = block_get_device(0);
+    readahead_enabled = (root != NULL && root->driver->map == NULL);
+
     // Check if file system already exists
     superblock_t sb;
     if (get_superblock(&sb) == 0 && sb.magic == FS_MAGIC) {
@@ -96,22 +132,30 @@ int fs_xv6_init(void)
         return 0;
     }
 
-    // Initialize buffer cache
-    buffer_init();
+    if (root->driver->persistent && !format_requested) {
+        return -1;  // Unrecognized disk - needs the format boot option
+    }
 
     // Get block device info
     unsigned int total_blocks;
     block_get_info(NULL, &total_blocks);
 
+    // Size the inode table and bitmap for this disk
+    unsigned int ninodes = total_blocks / BLOCKS_PER_INODE;
+    if (ninodes < NINODES) ninodes = NINODES;
+    if (ninodes > MAX_INODES) ninodes = MAX_INODES;
+    unsigned int inode_blocks = (ninodes + INODES_PER_BLOCK - 1) / INODES_PER_BLOCK;
+    unsigned int bitmap_blocks = (total_blocks - BITMAP_BLOCK - inode_blocks + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK;
+
     // Create new superblock
     superblock_t new_sb;
     new_sb.magic = FS_MAGIC;
     new_sb.size = total_blocks;
-    new_sb.nblocks = total_blocks - DATA_BLOCK_START;  // Data blocks available
-    new_sb.ninodes = NINODES;
-    new_sb.inode_start = INODE_TABLE_BLOCK;
+    new_sb.ninodes = ninodes;
     new_sb.bitmap_start = BITMAP_BLOCK;
-    new_sb.data_start = DATA_BLOCK_START;
+    new_sb.inode_start = BITMAP_BLOCK + bitmap_blocks;
+    new_sb.data_start = new_sb.inode_start + inode_blocks;
+    new_sb.nblocks = total_blocks - new_sb.data_start;  // Data blocks available
 
     // Write superblock
     if (put_superblock(&new_sb) != 0) {
@@ -119,24 +163,25 @@ int fs_xv6_init(void)
     }
 
     // Initialize bitmap (all blocks free initially)
+    // The table blocks are written directly rather than filling the cache;
+    // any stale cached copy is dropped first
     unsigned char bitmap_block[BLOCK_SIZE];
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        bitmap_block[i] = 0;  // All blocks free
-    }
-    if (block_write(BITMAP_BLOCK, bitmap_block) != 0) {
-        return -1;
+    memset(bitmap_block, 0, BLOCK_SIZE);  // All blocks free
+    for (unsigned int i = 0; i < bitmap_blocks; i++) {
+        binvalidate(new_sb.bitmap_start + i);
+        if (block_write(new_sb.bitmap_start + i, bitmap_block) != 0) {
+            return -1;
+        }
     }
 
     // Initialize inode table (all inodes free)
     unsigned char inode_block[BLOCK_SIZE];
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        inode_block[i] = 0;
-    }
+    memset(inode_block, 0, BLOCK_SIZE);
     
-    // Write inode blocks (calculate how many we need)
-    int inode_blocks = (NINODES * INODE_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    for (int i = 0; i < inode_blocks; i++) {
-        if (block_write(INODE_TABLE_BLOCK + i, inode_block) != 0) {
+    // Write inode blocks
+    for (unsigned int i = 0; i < inode_blocks; i++) {
+        binvalidate(new_sb.inode_start + i);
+        if (block_write(new_sb.inode_start + i, inode_block) != 0) {
             return -1;
         }
     }
@@ -164,9 +209,7 @@ int fs_xv6_init(void)
 
     // Write directory entries
     char dir_data[BLOCK_SIZE];
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        dir_data[i] = 0;
-    }
+    memset(dir_data, 0, BLOCK_SIZE);
     
     dirent_t* entries = (dirent_t*)dir_data;
     entries[0] = dot_entry;
@@ -181,7 +224,8 @@ int fs_xv6_init(void)
         return -1;
     }
 
-    return 0;
+    // Put the new file system on the disk before anything uses it
+    return (bflush() == 0) ? 0 : -1;
 }
 
 /**
@@ -199,15 +243,15 @@ unsigned int ialloc(unsigned short type)
     }
 
     // Read inode blocks and find free inode
-    int inode_blocks = (g_superblock.ninodes * INODE_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int inode_blocks = (g_superblock.ninodes + INODES_PER_BLOCK - 1) / INODES_PER_BLOCK;
     
     for (int block = 0; block < inode_blocks; block++) {
-        unsigned char inode_block[BLOCK_SIZE];
-        if (block_read(g_superblock.inode_start + block, inode_block) != 0) {
+        buf_t* b = bread(g_superblock.inode_start + block);
+        if (b == NULL) {
             continue;
         }
 
-        dinode_t* inodes = (dinode_t*)inode_block;
+        dinode_t* inodes = (dinode_t*)b->data;
         int inodes_in_block = BLOCK_SIZE / INODE_SIZE;
 
         for (int i = 0; i < inodes_in_block; i++) {
@@ -229,14 +273,14 @@ unsigned int ialloc(unsigned short type)
                     inodes[i].addrs[j] = 0;
                 }
 
-                // Write back to disk
-                if (block_write(g_superblock.inode_start + block, inode_block) != 0) {
-                    return 0;
-                }
-
+                // Write back to disk on eviction or sync
+                bdirty(b);
+                brelse(b);
                 return inum;
             }
         }
+
+        brelse(b);
     }
 
     return 0;  // No free inode found
@@ -253,19 +297,26 @@ void ifree(unsigned int inum)
         return;
     }
 
+    // A reused inode number starts with no access history
+    readahead_t* ra = &g_readahead[inum % READAHEAD_SLOTS];
+    if (ra->inum == inum) {
+        ra->inum = 0;
+    }
+
     // Calculate which block contains this inode
     int block_num = (inum - 1) / INODES_PER_BLOCK;
     int inode_offset = (inum - 1) % INODES_PER_BLOCK;
 
-    unsigned char inode_block[BLOCK_SIZE];
-    if (block_read(g_superblock.inode_start + block_num, inode_block) != 0) {
+    buf_t* b = bread(g_superblock.inode_start + block_num);
+    if (b == NULL) {
         return;
     }
 
-    dinode_t* inodes = (dinode_t*)inode_block;
+    dinode_t* inodes = (dinode_t*)b->data;
     inodes[inode_offset].type = 0;  // Mark as free
 
-    block_write(g_superblock.inode_start + block_num, inode_block);
+    bdirty(b);
+    brelse(b);
 }
 
 /**
@@ -298,16 +349,17 @@ int iget(unsigned int inum, inode_t* ip)
     int block_num = (inum - 1) / INODES_PER_BLOCK;
     int inode_offset = (inum - 1) % INODES_PER_BLOCK;
 
-    unsigned char inode_block[BLOCK_SIZE];
-    if (block_read(g_superblock.inode_start + block_num, inode_block) != 0) {
+    buf_t* b = bread(g_superblock.inode_start + block_num);
+    if (b == NULL) {
         return -1;
     }
 
-    dinode_t* inodes = (dinode_t*)inode_block;
+    dinode_t* inodes = (dinode_t*)b->data;
     ip->inum = inum;
     ip->ref = 1;
     ip->valid = 1;
     ip->dinode = inodes[inode_offset];
+    brelse(b);
 
     return 0;
 }
@@ -334,18 +386,16 @@ int iput(inode_t* ip)
     int block_num = (ip->inum - 1) / INODES_PER_BLOCK;
     int inode_offset = (ip->inum - 1) % INODES_PER_BLOCK;
 
-    unsigned char inode_block[BLOCK_SIZE];
-    if (block_read(g_superblock.inode_start + block_num, inode_block) != 0) {
+    buf_t* b = bread(g_superblock.inode_start + block_num);
+    if (b == NULL) {
         return -1;
     }
 
-    dinode_t* inodes = (dinode_t*)inode_block;
+    dinode_t* inodes = (dinode_t*)b->data;
     inodes[inode_offset] = ip->dinode;
 
-    if (block_write(g_superblock.inode_start + block_num, inode_block) != 0) {
-        return -1;
-    }
-
+    bdirty(b);
+    brelse(b);
     return 0;
 }
 
@@ -362,30 +412,40 @@ unsigned int balloc(void)
         }
     }
 
-    // Read bitmap
-    unsigned char bitmap[BLOCK_SIZE];
-    if (block_read(g_superblock.bitmap_start, bitmap) != 0) {
-        return 0;
-    }
+    unsigned int bitmap_blocks = g_superblock.inode_start - g_superblock.bitmap_start;
 
-    // Find first free block (bit == 0)
-    for (unsigned int i = 0; i < g_superblock.nblocks; i++) {
-        int byte = i / 8;
-        int bit = i % 8;
-
-        if (byte >= BLOCK_SIZE) {
-            break;  // Out of bitmap
+    for (unsigned int b = 0; b < bitmap_blocks; b++) {
+        // Read bitmap
+        buf_t* buf = bread(g_superblock.bitmap_start + b);
+        if (buf == NULL) {
+            return 0;
         }
+        unsigned char* bitmap = buf->data;
 
-        if ((bitmap[byte] & (1 << bit)) == 0) {
-            // Found free block - mark it as used
-            bitmap[byte] |= (1 << bit);
-            if (block_write(g_superblock.bitmap_start, bitmap) != 0) {
-                return 0;
+        // Find first free block (bit == 0)
+        for (int byte = 0; byte < BLOCK_SIZE; byte++) {
+            if (bitmap[byte] == 0xFF) {
+                continue;  // All 8 blocks in use
             }
 
-            return g_superblock.data_start + i;
+            for (int bit = 0; bit < 8; bit++) {
+                unsigned int i = b * BITS_PER_BLOCK + byte * 8 + bit;
+                if (i >= g_superblock.nblocks) {
+                    brelse(buf);
+                    return 0;  // Past the last data block
+                }
+
+                if ((bitmap[byte] & (1 << bit)) == 0) {
+                    // Found free block - mark it as used
+                    bitmap[byte] |= (1 << bit);
+                    bdirty(buf);
+                    brelse(buf);
+                    return g_superblock.data_start + i;
+                }
+            }
         }
+
+        brelse(buf);
     }
 
     return 0;  // No free blocks
@@ -407,18 +467,57 @@ void bfree(unsigned int block_num)
         return;  // Invalid block
     }
 
-    // Read bitmap
-    unsigned char bitmap[BLOCK_SIZE];
-    if (block_read(g_superblock.bitmap_start, bitmap) != 0) {
+    // Read bitmap block holding this block's bit
+    buf_t* b = bread(g_superblock.bitmap_start + block_index / BITS_PER_BLOCK);
+    if (b == NULL) {
         return;
     }
 
     // Clear bit
-    int byte = block_index / 8;
+    int byte = (block_index % BITS_PER_BLOCK) / 8;
     int bit = block_index % 8;
-    bitmap[byte] &= ~(1 << bit);
+    b->data[byte] &= ~(1 << bit);
+
+    bdirty(b);
+    brelse(b);
+
+    // The freed block's cached contents must not be served again
+    binvalidate(block_num);
+}
+
+/**
+ * Free a list of data blocks and discard them on the device
+ *
+ * @param blocks: Block numbers (0 entries are skipped)
+ * @param count: Number of entries
+ */
+void bfree_blocks(unsigned int* blocks, unsigned int count)
+{
+    unsigned int run_start = 0;
+    unsigned int run_length = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (blocks[i] == 0) {
+            continue;
+        }
+
+        bfree(blocks[i]);
+
+        // Extend the current run or flush it and start a new one
+        if (run_length > 0 && blocks[i] == run_start + run_length) {
+            run_length++;
+        } else {
+            if (run_length > 0) {
+                block_discard(run_start, run_length);
+            }
+            run_start = blocks[i];
+            run_length = 1;
+        }
+    }
 
-    block_write(g_superblock.bitmap_start, bitmap);
+    if (run_length > 0) {
+        block_discard(run_start, run_length);
+    }
 }
 
 /**
@@ -451,6 +550,70 @@ unsigned int bmap(inode_t* ip, unsigned int bn)
     return ip->dinode.addrs[bn];
 }
 
+/**
+ * Prefetch the blocks a read needs plus a readahead window
+ * The window doubles while reads on the inode are sequential (or restart
+ * at offset 0) and halves when they jump; at zero nothing is prefetched
+ * and readi goes to the device as before. Prefetching starts when the
+ * read's first block is not cached, or when sequential reads move past
+ * the blocks already prefetched, so rereading a cached file costs one
+ * lookup here.
+ *
+ * @param ip: Pointer to inode
+ * @param offset: Byte offset of the read
+ * @param n: Bytes being read (non-zero, within the file)
+ */
+static void readahead(inode_t* ip, unsigned int offset, unsigned int n)
+{
+    readahead_t* ra = &g_readahead[ip->inum % READAHEAD_SLOTS];
+    if (ra->inum != ip->inum) {
+        ra->inum = ip->inum;
+        ra->next_offset = 0;
+        ra->window = 0;
+        ra->ahead_end = 0;
+    }
+
+    if (offset == 0 || offset == ra->next_offset) {
+        ra->window = (ra->window == 0) ? READAHEAD_MIN : ra->window * 2;
+        if (ra->window > READAHEAD_MAX) {
+            ra->window = READAHEAD_MAX;
+        }
+    } else {
+        ra->window /= 2;
+    }
+    ra->next_offset = offset + n;
+
+    // Only direct blocks exist (like bmap); a corrupt size can point past them
+    unsigned int first = offset / BLOCK_SIZE;
+    if (first >= 12) {
+        return;
+    }
+    if (ra->window == 0 || ip->dinode.addrs[first] == 0) {
+        return;
+    }
+
+    // This read's blocks and the window after it, up to the end of the file
+    unsigned int last = (offset + n - 1) / BLOCK_SIZE + ra->window;
+    unsigned int end = (ip->dinode.size - 1) / BLOCK_SIZE;
+    if (last > end) last = end;
+    if (last > 11) last = 11;
+
+    // A cached first block means earlier readahead covered this read
+    if (bfind(ip->dinode.addrs[first]) != NULL && first < ra->ahead_end) {
+        first = ra->ahead_end;
+    }
+
+    unsigned int blocks[12];
+    unsigned int count = 0;
+    for (unsigned int bn = first; bn <= last && ip->dinode.addrs[bn] != 0; bn++) {
+        blocks[count++] = ip->dinode.addrs[bn];
+    }
+    if (count > 0) {
+        breadahead(blocks, count);
+        ra->ahead_end = first + count;
+    }
+}
+
 /**
  * Read data from inode
  * 
@@ -474,9 +637,19 @@ int readi(inode_t* ip, char* dst, unsigned int offset, unsigned int n)
         n = ip->dinode.size - offset;  // Don't read past end
     }
 
+    // Sequential reads find their blocks cached, loaded by one device read
+    if (n > 0 && readahead_enabled) {
+        readahead(ip, offset, n);
+    }
+
     unsigned int total_read = 0;
     unsigned int current_offset = offset;
 
+    // Cached and partial blocks go through the buffer cache; whole uncached
+    // blocks are read straight into dst, batched into one vectored read
+    block_vec_t vec[12];
+    unsigned int nvec = 0;
+
     while (total_read < n) {
         // Calculate which block we're in
         unsigned int block_num = current_offset / BLOCK_SIZE;
@@ -492,21 +665,33 @@ int readi(inode_t* ip, char* dst, unsigned int offset, unsigned int n)
             break;  // Block not allocated
         }
 
-        // Read block
-        unsigned char block_data[BLOCK_SIZE];
-        if (block_read(phys_block, block_data) != 0) {
-            return -1;
-        }
-
-        // Copy data
-        for (unsigned int i = 0; i < to_read; i++) {
-            dst[total_read + i] = block_data[block_offset + i];
+        // Copy straight out of the device when it can map blocks
+        buf_t* b = bfind(phys_block);
+        unsigned char* mapped;
+        if (b == NULL && to_read == BLOCK_SIZE && block_map(phys_block, 0, &mapped) == 0) {
+            memcpy(dst + total_read, mapped, BLOCK_SIZE);
+            block_unmap(phys_block);
+        } else if (b == NULL && to_read == BLOCK_SIZE) {
+            vec[nvec].block = phys_block;
+            vec[nvec].buffer = (unsigned char*)dst + total_read;
+            nvec++;
+        } else {
+            b = bread(phys_block);
+            if (b == NULL) {
+                return -1;
+            }
+            memcpy(dst + total_read, b->data + block_offset, to_read);
+            brelse(b);
         }
 
         total_read += to_read;
         current_offset += to_read;
     }
 
+    if (nvec > 0 && block_readv(vec, nvec) != 0) {
+        return -1;
+    }
+
     return total_read;
 }
 
@@ -528,6 +713,11 @@ int writei(inode_t* ip, char* src, unsigned int offset, unsigned int n)
     unsigned int total_written = 0;
     unsigned int current_offset = offset;
 
+    // Cached and partial blocks go through the buffer cache; whole uncached
+    // blocks are written straight from src, batched into one vectored write
+    block_vec_t vec[12];
+    unsigned int nvec = 0;
+
     while (total_written < n) {
         // Calculate which block we're in
         unsigned int block_num = current_offset / BLOCK_SIZE;
@@ -543,33 +733,37 @@ int writei(inode_t* ip, char* src, unsigned int offset, unsigned int n)
             return -1;  // Out of blocks
         }
 
-        // Read existing block (if partial write)
-        unsigned char block_data[BLOCK_SIZE];
-        if (block_offset > 0 || to_write < BLOCK_SIZE) {
-            if (block_read(phys_block, block_data) != 0) {
-                return -1;
-            }
+        // Write straight into the device when it can map blocks
+        buf_t* b = bfind(phys_block);
+        unsigned char* mapped;
+        if (b == NULL && to_write == BLOCK_SIZE && block_map(phys_block, 1, &mapped) == 0) {
+            memcpy(mapped, src + total_written, BLOCK_SIZE);
+            block_unmap(phys_block);
+        } else if (b == NULL && to_write == BLOCK_SIZE) {
+            vec[nvec].block = phys_block;
+            vec[nvec].buffer = (unsigned char*)src + total_written;
+            nvec++;
         } else {
-            // Full block write - zero it first
-            for (int i = 0; i < BLOCK_SIZE; i++) {
-                block_data[i] = 0;
+            // Cached or partial block: read, modify, write
+            b = bread(phys_block);
+            if (b == NULL) {
+                return -1;
             }
-        }
 
-        // Copy data into block
-        for (unsigned int i = 0; i < to_write; i++) {
-            block_data[block_offset + i] = src[total_written + i];
-        }
-
-        // Write block
-        if (block_write(phys_block, block_data) != 0) {
-            return -1;
+            // Copy data into block
+            memcpy(b->data + block_offset, src + total_written, to_write);
+            bdirty(b);
+            brelse(b);
         }
 
         total_written += to_write;
         current_offset += to_write;
     }
 
+    if (nvec > 0 && block_writev(vec, nvec) != 0) {
+        return -1;
+    }
+
     // Update file size
     if (current_offset > ip->dinode.size) {
         ip->dinode.size = current_offset;
@@ -580,6 +774,8 @@ int writei(inode_t* ip, char* src, unsigned int offset, unsigned int n)
 
 /**
  * Look up directory entry
+ * Entries are compared in place, one cached directory block at a time
+ * (entries never straddle blocks)
  * 
  * @param dp: Pointer to directory inode
  * @param name: Filename to find
@@ -591,20 +787,32 @@ unsigned int dirlookup(inode_t* dp, char* name)
         return 0;
     }
 
-    // Read directory entries
-    char dir_data[BLOCK_SIZE * 12];  // Max 12 blocks for directory
-    int bytes_read = readi(dp, dir_data, 0, dp->dinode.size);
-    if (bytes_read <= 0) {
-        return 0;
-    }
+    for (unsigned int bn = 0; bn < 12 && bn * BLOCK_SIZE < dp->dinode.size; bn++) {
+        if (dp->dinode.addrs[bn] == 0) {
+            break;  // Block not allocated
+        }
 
-    dirent_t* entries = (dirent_t*)dir_data;
-    int num_entries = bytes_read / sizeof(dirent_t);
+        buf_t* b = bread(dp->dinode.addrs[bn]);
+        if (b == NULL) {
+            return 0;
+        }
 
-    for (int i = 0; i < num_entries; i++) {
-        if (strcmp(entries[i].name, name) == 0) {
-            return entries[i].inum;
+        unsigned int bytes = dp->dinode.size - bn * BLOCK_SIZE;
+        if (bytes > BLOCK_SIZE) {
+            bytes = BLOCK_SIZE;
         }
+
+        dirent_t* entries = (dirent_t*)b->data;
+        unsigned int num_entries = bytes / sizeof(dirent_t);
+        for (unsigned int i = 0; i < num_entries; i++) {
+            if (strcmp(entries[i].name, name) == 0) {
+                unsigned int inum = entries[i].inum;
+                brelse(b);
+                return inum;
+            }
+        }
+
+        brelse(b);
     }
 
     return 0;  // Not found
@@ -0,0 +1,109 @@
+#include "io.h"
+
+/**
+ * Read a byte from an I/O port
+ *
+ * @param port: Port number
+ * @return: Byte read
+ */
+unsigned char inb(unsigned short port)
+{
+    unsigned char value;
+    __asm__ volatile ("inb %1, %0" : "=a" (value) : "Nd" (port));
+    return value;
+}
+
+/**
+ * Write a byte to an I/O port
+ *
+ * @param port: Port number
+ * @param value: Byte to write
+ */
+void outb(unsigned short port, unsigned char value)
+{
+    __asm__ volatile ("outb %0, %1" : : "a" (value), "Nd" (port));
+}
+
+/**
+ * Read a 16-bit word from an I/O port
+ *
+ * @param port: Port number
+ * @return: Word read
+ */
+unsigned short inw(unsigned short port)
+{
+    unsigned short value;
+    __asm__ volatile ("inw %1, %0" : "=a" (value) : "Nd" (port));
+    return value;
+}
+
+/**
+ * Write a 16-bit word to an I/O port
+ *
+ * @param port: Port number
+ * @param value: Word to write
+ */
+void outw(unsigned short port, unsigned short value)
+{
+    __asm__ volatile ("outw %0, %1" : : "a" (value), "Nd" (port));
+}
+
+/**
+ * Read a 32-bit value from an I/O port
+ *
+ * @param port: Port number
+ * @return: Value read
+ */
+unsigned int inl(unsigned short port)
+{
+    unsigned int value;
+    __asm__ volatile ("inl %1, %0" : "=a" (value) : "Nd" (port));
+    return value;
+}
+
+/**
+ * Write a 32-bit value to an I/O port
+ *
+ * @param port: Port number
+ * @param value: Value to write
+ */
+void outl(unsigned short port, unsigned int value)
+{
+    __asm__ volatile ("outl %0, %1" : : "a" (value), "Nd" (port));
+}
+
+/**
+ * Read a run of 16-bit words from an I/O port
+ *
+ * @param port: Port number
+ * @param buffer: Destination (count words)
+ * @param count: Number of words
+ */
+void insw(unsigned short port, void* buffer, unsigned int count)
+{
+    __asm__ volatile ("rep insw" : "+D" (buffer), "+c" (count) : "d" (port) : "memory");
+}
+
+/**
+ * Write a run of 16-bit words to an I/O port
+ *
+ * @param port: Port number
+ * @param buffer: Source (count words)
+ * @param count: Number of words
+ */
+void outsw(unsigned short port, const void* buffer, unsigned int count)
+{
+    __asm__ volatile ("rep outsw" : "+S" (buffer), "+c" (count) : "d" (port));
+}
+
+/**
+ * Read the CPU timestamp counter
+ *
+ * @return: Cycles since reset
+ */
+unsigned long long rdtsc(void)
+{
+    unsigned int lo, hi;
+    __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
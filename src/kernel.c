@@ -2,12 +2,67 @@
 #include "keyboard.h"
 #include "shell.h"
 #include "malloc.h"
+#include "pmm.h"
+#include "multiboot.h"
 #include "inode.h"
+#include "ramdisk.h"
 
-void main(void)
+extern char kernel_end[];  // End of kernel image (from linker.ld)
+
+// Parse a size boot option such as "ramdisk=64M" (K, M and G suffixes)
+// Values too big for 32 bits (e.g. "ramdisk=4G") are clamped to the largest one
+// Returns 0 if the option is not present
+static unsigned int boot_option_size(const char* cmdline, const char* name)
+{
+    int name_len = strlen(name);
+
+    for (const char* p = cmdline; *p != '\0'; p++) {
+        // Options start at the beginning or after a space
+        if (p != cmdline && p[-1] != ' ') continue;
+
+        int i = 0;
+        while (i < name_len && p[i] == name[i]) i++;
+        if (i != name_len) continue;
+
+        unsigned int value = 0;
+        p += name_len;
+        while (*p >= '0' && *p <= '9') {
+            unsigned int digit = *p - '0';
+            value = (value > (0xFFFFFFFFu - digit) / 10) ? 0xFFFFFFFFu : value * 10 + digit;
+            p++;
+        }
+
+        int shift = 0;
+        if (*p == 'K' || *p == 'k') shift = 10;
+        else if (*p == 'M' || *p == 'm') shift = 20;
+        else if (*p == 'G' || *p == 'g') shift = 30;
+
+        // Check before shifting: bits shifted out would wrap the size
+        if (value > (0xFFFFFFFFu >> shift)) {
+            return 0xFFFFFFFFu;
+        }
+        return value << shift;
+    }
+
+    return 0;
+}
+
+void main(unsigned int magic, multiboot_info_t* mbi)
 {
     clear_screen();
 
+    // Initialize physical page allocator from the bootloader's memory map
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC) {
+        pmm_init(mbi, (unsigned long)kernel_end);
+
+        // Boot options
+        if (mbi->flags & MULTIBOOT_INFO_CMDLINE) {
+            ramdisk_set_size(boot_option_size((const char*)mbi->cmdline, "ramdisk="));
+            ramdisk_set_compression(boot_option_size((const char*)mbi->cmdline, "ramdisk_compress=") != 0);
+            fs_set_format(boot_option_size((const char*)mbi->cmdline, "format=") != 0);
+        }
+    }
+
     // Initialize memory allocator
     heap_init();
 
@@ -1,6 +1,7 @@
 #include "keyboard.h"
 #include "source.h"
 #include "shell.h"
+#include "io.h"
 
 int clicked = 0;
 int canSend = 0;
@@ -8,13 +9,10 @@ extern shell_state_t shell_state;
 
 unsigned char get_scancode()
 {
-    unsigned char status;
-    __asm__ volatile ("inb $0x64, %0" : "=a" (status));
+    unsigned char status = inb(0x64);  // Controller status
 
     if (status & 0x01) {
-        unsigned char inputdata;
-        __asm__ volatile ("inb $0x60, %0" : "=a" (inputdata));
-        return inputdata;
+        return inb(0x60);  // Keyboard data
     }
 
     return 0;
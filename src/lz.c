@@ -0,0 +1,201 @@
+#include "lz.h"
+#include "source.h"
+
+#define LZ_NO_MATCH 0xFFFFFFFFu
+
+/**
+ * Read four bytes as a little-endian word (any alignment)
+ *
+ * @param p: Source
+ * @return: Word value
+ */
+static unsigned int lz_read32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/**
+ * Hash four bytes into the match finder table
+ *
+ * @param word: Four input bytes
+ * @return: Table index
+ */
+static unsigned int lz_hash(unsigned int word)
+{
+    return (word * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * Append the extra bytes of a length whose nibble saturated at 15
+ *
+ * @param dst: Output buffer
+ * @param op: Output position (advanced)
+ * @param capacity: Output buffer size
+ * @param extra: Length minus 15
+ * @return: 0 on success, -1 if the output is full
+ */
+static int lz_put_length(unsigned char* dst, unsigned int* op, unsigned int capacity, unsigned int extra)
+{
+    while (extra >= 255) {
+        if (*op >= capacity) return -1;
+        dst[(*op)++] = 255;
+        extra -= 255;
+    }
+    if (*op >= capacity) return -1;
+    dst[(*op)++] = extra;
+    return 0;
+}
+
+/**
+ * Append one sequence
+ *
+ * @param dst: Output buffer
+ * @param op: Output position (advanced)
+ * @param capacity: Output buffer size
+ * @param literals: Literal bytes
+ * @param nliterals: Number of literal bytes
+ * @param offset: Match offset (ignored when match_length is 0)
+ * @param match_length: Match length (0 for the final, literal-only sequence)
+ * @return: 0 on success, -1 if the output is full
+ */
+static int lz_put_sequence(unsigned char* dst, unsigned int* op, unsigned int capacity,
+                           const unsigned char* literals, unsigned int nliterals,
+                           unsigned int offset, unsigned int match_length)
+{
+    unsigned int match_code = match_length ? match_length - LZ_MIN_MATCH : 0;
+
+    if (*op >= capacity) return -1;
+    dst[(*op)++] = ((nliterals < 15 ? nliterals : 15) << 4) | (match_code < 15 ? match_code : 15);
+
+    if (nliterals >= 15 && lz_put_length(dst, op, capacity, nliterals - 15) != 0) return -1;
+    if (*op + nliterals > capacity) return -1;
+    memcpy(dst + *op, literals, nliterals);
+    *op += nliterals;
+
+    if (match_length == 0) {
+        return 0;
+    }
+
+    if (*op + 2 > capacity) return -1;
+    dst[(*op)++] = offset & 0xFF;
+    dst[(*op)++] = offset >> 8;
+    if (match_code >= 15 && lz_put_length(dst, op, capacity, match_code - 15) != 0) return -1;
+
+    return 0;
+}
+
+/**
+ * Compress a buffer
+ * Greedy parse: the hash table remembers the last position of each
+ * four-byte prefix, and any verified match is taken and extended
+ *
+ * @param state: Working memory (holds the hash table)
+ * @param src: Input
+ * @param length: Input size in bytes
+ * @param dst: Output buffer
+ * @param capacity: Output buffer size
+ * @return: Compressed size, or 0 if it would not fit in capacity
+ */
+unsigned int lz_compress(lz_state_t* state, const unsigned char* src, unsigned int length, unsigned char* dst, unsigned int capacity)
+{
+    unsigned int* table = state->table;
+    unsigned int ip = 0;
+    unsigned int anchor = 0;
+    unsigned int op = 0;
+
+    memset(table, 0xFF, sizeof(state->table));
+
+    while (ip + LZ_MIN_MATCH <= length) {
+        unsigned int word = lz_read32(src + ip);
+        unsigned int h = lz_hash(word);
+        unsigned int ref = table[h];
+        table[h] = ip;
+
+        if (ref == LZ_NO_MATCH || ip - ref > LZ_MAX_OFFSET || lz_read32(src + ref) != word) {
+            ip++;
+            continue;
+        }
+
+        unsigned int match_length = LZ_MIN_MATCH;
+        while (ip + match_length < length && src[ref + match_length] == src[ip + match_length]) {
+            match_length++;
+        }
+
+        if (lz_put_sequence(dst, &op, capacity, src + anchor, ip - anchor, ip - ref, match_length) != 0) {
+            return 0;
+        }
+        ip += match_length;
+        anchor = ip;
+    }
+
+    // Whatever is left goes out as literals
+    if (lz_put_sequence(dst, &op, capacity, src + anchor, length - anchor, 0, 0) != 0) {
+        return 0;
+    }
+
+    return op;
+}
+
+/**
+ * Decompress a buffer
+ * Every length and offset is checked, so corrupt input cannot write
+ * outside dst
+ *
+ * @param src: Compressed input
+ * @param length: Compressed size
+ * @param dst: Output buffer
+ * @param dst_length: Exact decompressed size expected
+ * @return: 0 on success, -1 if the input is corrupt
+ */
+int lz_decompress(const unsigned char* src, unsigned int length, unsigned char* dst, unsigned int dst_length)
+{
+    unsigned int ip = 0;
+    unsigned int op = 0;
+
+    while (ip < length) {
+        unsigned int token = src[ip++];
+
+        // Literals
+        unsigned int nliterals = token >> 4;
+        if (nliterals == 15) {
+            unsigned int b;
+            do {
+                if (ip >= length) return -1;
+                b = src[ip++];
+                nliterals += b;
+            } while (b == 255);
+        }
+        if (nliterals > length - ip || nliterals > dst_length - op) return -1;
+        memcpy(dst + op, src + ip, nliterals);
+        ip += nliterals;
+        op += nliterals;
+
+        if (ip == length) {
+            break;  // Final sequence has no match
+        }
+
+        // Match
+        if (length - ip < 2) return -1;
+        unsigned int offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        unsigned int match_length = (token & 0x0F) + LZ_MIN_MATCH;
+        if ((token & 0x0F) == 15) {
+            unsigned int b;
+            do {
+                if (ip >= length) return -1;
+                b = src[ip++];
+                match_length += b;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > op || match_length > dst_length - op) return -1;
+
+        // Byte by byte: the match may overlap the bytes it produces
+        const unsigned char* from = dst + op - offset;
+        for (unsigned int i = 0; i < match_length; i++) {
+            dst[op + i] = from[i];
+        }
+        op += match_length;
+    }
+
+    return (op == dst_length) ? 0 : -1;
+}
@@ -1,37 +1,576 @@
 #include "malloc.h"
 #include "source.h"
 
-// Heap memory region
-static char heap[HEAP_SIZE];
-static block_header_t* free_list = NULL;
+// Initial heap chunk (aligned to its size so any address maps to its chunk)
+static char heap[HEAP_SIZE] __attribute__((aligned(HEAP_SIZE)));
+static heap_chunk_t* chunks = NULL;  // All chunks, newest first
 static int heap_initialized = 0;
 
+// Segregated free bins: bin i holds free blocks of size [2^i, 2^(i+1))
+static block_header_t* bins[HEAP_BINS];
+static unsigned int bin_map = 0;  // Bit i set when bins[i] is non-empty
+
+// Smallest block that can stand on its own when a free block is split
+#define MIN_FREE_BLOCK  ((sizeof(block_header_t) + sizeof(block_footer_t) + MIN_BLOCK_SIZE + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
+
+// Offset of the prologue within a chunk (right after the chunk header)
+#define CHUNK_BLOCKS    ((sizeof(heap_chunk_t) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
+
+// Slab state
+static slab_cache_t slab_caches[SLAB_CLASSES];
+
+// Live counters (see heap_stats_t)
+static unsigned int chunk_count = 0;
+static unsigned int bytes_in_use = 0;
+static unsigned int peak_in_use = 0;
+static unsigned int free_bytes = 0;
+static unsigned int free_blocks = 0;
+static unsigned int page_bytes = 0;
+
+/**
+ * Get the footer (boundary tag) of a block
+ *
+ * @param block: Block header
+ * @return: Pointer to the block's footer
+ */
+static block_footer_t* footer_of(block_header_t* block)
+{
+    return (block_footer_t*)((char*)block + block->size - sizeof(block_footer_t));
+}
+
+/**
+ * Set a block's size and state in both header and footer
+ *
+ * @param block: Block header
+ * @param size: Block size including header and footer
+ * @param free: 1 if free, 0 if allocated
+ */
+static void block_set(block_header_t* block, unsigned int size, int free)
+{
+    block->size = size;
+    block->free = free;
+    block_footer_t* footer = footer_of(block);
+    footer->size = size;
+    footer->free = free;
+}
+
+/**
+ * Map a block size to its free bin
+ *
+ * @param size: Block size in bytes
+ * @return: Bin index (floor(log2(size)))
+ */
+static int bin_index(unsigned int size)
+{
+    return 31 - __builtin_clz(size);
+}
+
+/**
+ * Push a free block onto its bin
+ *
+ * @param block: Free block
+ */
+static void bin_insert(block_header_t* block)
+{
+    int i = bin_index(block->size);
+    block->prev = NULL;
+    block->next = bins[i];
+    if (bins[i]) {
+        bins[i]->prev = block;
+    }
+    bins[i] = block;
+    bin_map |= 1u << i;
+
+    free_bytes += block->size;
+    free_blocks++;
+}
+
+/**
+ * Unlink a free block from its bin
+ *
+ * @param block: Free block
+ */
+static void bin_remove(block_header_t* block)
+{
+    int i = bin_index(block->size);
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        bins[i] = block->next;
+        if (bins[i] == NULL) {
+            bin_map &= ~(1u << i);
+        }
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+
+    free_bytes -= block->size;
+    free_blocks--;
+}
+
+/**
+ * Take a free block of at least `size` bytes out of the bins
+ * Searches the block's own bin first-fit, then takes the head of the
+ * next non-empty larger bin (every block there is big enough)
+ *
+ * @param size: Required block size
+ * @return: Free block (already unlinked), or NULL if none is large enough
+ */
+static block_header_t* bin_find(unsigned int size)
+{
+    int i = bin_index(size);
+
+    for (block_header_t* block = bins[i]; block != NULL; block = block->next) {
+        if (block->size >= size) {
+            bin_remove(block);
+            return block;
+        }
+    }
+
+    unsigned int larger = (i + 1 < HEAP_BINS) ? bin_map & ~((2u << i) - 1) : 0;
+    if (larger == 0) {
+        return NULL;
+    }
+
+    block_header_t* block = bins[__builtin_ctz(larger)];
+    bin_remove(block);
+    return block;
+}
+
+/**
+ * Get the chunk containing a heap address
+ *
+ * @param ptr: Address inside a heap chunk
+ * @return: Chunk header
+ */
+static heap_chunk_t* chunk_of(void* ptr)
+{
+    return (heap_chunk_t*)((unsigned long)ptr & ~(unsigned long)(HEAP_SIZE - 1));
+}
+
+/**
+ * Add a chunk of memory to the heap
+ * Sets up its header and one free block covering the rest of the chunk,
+ * bounded by allocated sentinels
+ *
+ * @param base: HEAP_SIZE-aligned start of the chunk
+ */
+static void heap_add_chunk(char* base)
+{
+    heap_chunk_t* chunk = (heap_chunk_t*)base;
+    for (int i = 0; i < HEAP_PAGES; i++) {
+        chunk->slabs[i].cache = NULL;
+    }
+    chunk->next = chunks;
+    chunks = chunk;
+    chunk_count++;
+
+    // Prologue: an allocated footer so the first block never merges backwards
+    block_footer_t* prologue = (block_footer_t*)(base + CHUNK_BLOCKS);
+    prologue->size = 0;
+    prologue->free = 0;
+
+    // Epilogue: an allocated, zero-sized header so the last block never merges forwards
+    block_header_t* epilogue = (block_header_t*)(base + HEAP_SIZE - sizeof(block_header_t));
+    epilogue->size = 0;
+    epilogue->free = 0;
+
+    // Initialize first block as free, covering the rest of the chunk
+    block_header_t* first_block = (block_header_t*)(base + CHUNK_BLOCKS + sizeof(block_footer_t));
+    block_set(first_block, (char*)epilogue - (char*)first_block, 1);
+    bin_insert(first_block);
+}
+
+/**
+ * Grow the heap by one chunk from the page-frame allocator
+ *
+ * @return: 0 on success, -1 if out of memory
+ */
+static int heap_grow(void)
+{
+    char* base = (char*)pmm_alloc_pages(HEAP_CHUNK_ORDER);
+    if (base == NULL) {
+        return -1;
+    }
+
+    heap_add_chunk(base);
+    return 0;
+}
+
 /**
  * Initialize the heap allocator
- * Sets up the initial free block covering the entire heap
+ * Sets up the static chunk and the empty size-class caches
  */
 void heap_init(void)
 {
     if (heap_initialized) return;
 
-    // Initialize first block as free, covering entire heap
-    block_header_t* first_block = (block_header_t*)heap;
-    first_block->size = HEAP_SIZE;
-    first_block->free = 1;
-    first_block->next = NULL;
-    
-    free_list = first_block;
+    for (int i = 0; i < HEAP_BINS; i++) {
+        bins[i] = NULL;
+    }
+    bin_map = 0;
+
+    chunks = NULL;
+    chunk_count = 0;
+    heap_add_chunk(heap);
+
+    // Set up size classes: 16, 32, ..., SLAB_MAX_SIZE
+    unsigned int object_size = SLAB_MIN_SIZE;
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        slab_caches[i].object_size = object_size;
+        slab_caches[i].objects = PAGE_SIZE / object_size;
+        slab_caches[i].partial = NULL;
+        slab_caches[i].slabs = 0;
+        slab_caches[i].active = 0;
+        slab_caches[i].allocs = 0;
+        object_size <<= 1;
+    }
+
     heap_initialized = 1;
 }
 
 /**
- * Allocate memory block
- * Uses first-fit algorithm: find first free block large enough
- * 
+ * Allocate a block from the free bins
+ * The data area holds `size` bytes starting at an `align`-byte boundary
+ *
  * @param size: Number of bytes to allocate
+ * @param align: Required alignment of the returned pointer (power of two)
  * @return: Pointer to allocated memory, or NULL if out of memory
  */
-void* kmalloc(unsigned int size)
+static void* block_alloc(unsigned int size, unsigned int align)
+{
+    // Add header and footer size and align
+    unsigned int total_size = size + sizeof(block_header_t) + sizeof(block_footer_t);
+    total_size = (total_size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+
+    // Minimum block size
+    if (total_size < MIN_FREE_BLOCK) {
+        total_size = MIN_FREE_BLOCK;
+    }
+
+    // Over-aligned requests need room for a leading pad block
+    unsigned int search_size = total_size;
+    if (align > BLOCK_ALIGN) {
+        search_size += align + MIN_FREE_BLOCK;
+    }
+
+    block_header_t* block = bin_find(search_size);
+    if (block == NULL) {
+        // No suitable block found - add a chunk and try again
+        if (search_size > HEAP_SIZE - CHUNK_BLOCKS - 2 * sizeof(block_header_t) || heap_grow() != 0) {
+            return NULL;
+        }
+        block = bin_find(search_size);
+    }
+
+    if (align > BLOCK_ALIGN) {
+        // Padding needed in front of the block to align its data.
+        // A non-zero pad must be big enough to stay behind as a free block.
+        unsigned long data = (unsigned long)block + sizeof(block_header_t);
+        unsigned long pad = ((data + align - 1) & ~(unsigned long)(align - 1)) - data;
+        while (pad != 0 && pad < MIN_FREE_BLOCK) {
+            pad += align;
+        }
+
+        if (pad != 0) {
+            block_header_t* front = block;
+            unsigned int block_size = front->size - pad;
+            block = (block_header_t*)((char*)front + pad);
+            block_set(front, pad, 1);
+            bin_insert(front);
+            block->size = block_size;
+        }
+    }
+
+    // If block is much larger, split it and bin the remainder
+    if (block->size >= total_size + MIN_FREE_BLOCK) {
+        block_header_t* rest = (block_header_t*)((char*)block + total_size);
+        block_set(rest, block->size - total_size, 1);
+        bin_insert(rest);
+        block->size = total_size;
+    }
+
+    // Mark as allocated
+    block_set(block, block->size, 0);
+    block->next = NULL;
+    block->prev = NULL;
+
+    // Return pointer to data (after header)
+    return (void*)((char*)block + sizeof(block_header_t));
+}
+
+/**
+ * Return a block to the free bins
+ * Boundary tags let it merge with both physical neighbours in O(1)
+ *
+ * @param ptr: Pointer to memory to free (must be from block_alloc)
+ * @return: Size of the freed data area, or 0 on double free
+ */
+static unsigned int block_free(void* ptr)
+{
+    // Get block header
+    block_header_t* block = (block_header_t*)((char*)ptr - sizeof(block_header_t));
+
+    if (block->free) {
+        // Already free - double free error
+        return 0;
+    }
+
+    unsigned int size = block->size;
+    unsigned int data_size = size - sizeof(block_header_t) - sizeof(block_footer_t);
+
+    // Merge with previous block (found through its footer)
+    block_footer_t* prev_footer = (block_footer_t*)((char*)block - sizeof(block_footer_t));
+    if (prev_footer->free) {
+        block_header_t* prev = (block_header_t*)((char*)block - prev_footer->size);
+        bin_remove(prev);
+        size += prev->size;
+        block = prev;
+    }
+
+    // Merge with next block
+    block_header_t* next = (block_header_t*)((char*)block + size);
+    if (next->free) {
+        bin_remove(next);
+        size += next->size;
+    }
+
+    block_set(block, size, 1);
+    bin_insert(block);
+
+    return data_size;
+}
+
+/**
+ * Resize an allocated block without moving it
+ * Grows by absorbing the next block if it is free; a tail that is no
+ * longer needed is split off and merged with a free successor
+ *
+ * @param block: Allocated block
+ * @param size: New data size in bytes
+ * @return: 0 on success, -1 if the block cannot grow in place
+ */
+static int block_resize(block_header_t* block, unsigned int size)
+{
+    unsigned int total_size = size + sizeof(block_header_t) + sizeof(block_footer_t);
+    total_size = (total_size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+    if (total_size < MIN_FREE_BLOCK) {
+        total_size = MIN_FREE_BLOCK;
+    }
+
+    block_header_t* next = (block_header_t*)((char*)block + block->size);
+
+    // Grow into the next block
+    if (total_size > block->size) {
+        if (!next->free || block->size + next->size < total_size) {
+            return -1;
+        }
+        bin_remove(next);
+        block->size += next->size;
+        next = (block_header_t*)((char*)block + block->size);
+    }
+
+    // Give the unused tail back, merged with a free successor
+    unsigned int tail = block->size - total_size;
+    if (next->free) {
+        bin_remove(next);
+        tail += next->size;
+    }
+    if (tail >= MIN_FREE_BLOCK) {
+        block_header_t* rest = (block_header_t*)((char*)block + total_size);
+        block_set(rest, tail, 1);
+        bin_insert(rest);
+        block->size = total_size;
+    }
+
+    block_set(block, block->size, 0);
+    return 0;
+}
+
+/**
+ * Find the slab descriptor for a heap address
+ *
+ * @param ptr: Address inside the heap
+ * @return: Descriptor of the page containing ptr (cache is NULL if not a slab)
+ */
+static slab_t* slab_of(void* ptr)
+{
+    heap_chunk_t* chunk = chunk_of(ptr);
+    return &chunk->slabs[((char*)ptr - (char*)chunk) / PAGE_SIZE];
+}
+
+/**
+ * Map a request size to its size class
+ *
+ * @param size: Requested size (1..SLAB_MAX_SIZE)
+ * @return: Size class index
+ */
+static int slab_class(unsigned int size)
+{
+    int cls = 0;
+    unsigned int object_size = SLAB_MIN_SIZE;
+    while (object_size < size) {
+        object_size <<= 1;
+        cls++;
+    }
+    return cls;
+}
+
+/**
+ * Add a fresh slab page to a cache
+ * The page comes from the block allocator and is carved into objects
+ *
+ * @param cache: Cache to grow
+ * @return: New slab, or NULL if out of memory
+ */
+static slab_t* slab_grow(slab_cache_t* cache)
+{
+    char* page = (char*)block_alloc(PAGE_SIZE, PAGE_SIZE);
+    if (page == NULL) {
+        return NULL;
+    }
+
+    slab_t* slab = slab_of(page);
+    slab->cache = cache;
+    slab->inuse = 0;
+    cache->slabs++;
+
+    // Thread all objects onto the slab's free list
+    slab->free = NULL;
+    for (int i = cache->objects - 1; i >= 0; i--) {
+        void** object = (void**)(page + i * cache->object_size);
+        *object = slab->free;
+        slab->free = object;
+    }
+
+    // Becomes the only partial slab
+    slab->prev = NULL;
+    slab->next = cache->partial;
+    if (cache->partial) {
+        cache->partial->prev = slab;
+    }
+    cache->partial = slab;
+
+    return slab;
+}
+
+/**
+ * Unlink a slab from its cache's partial list
+ *
+ * @param slab: Slab to unlink
+ */
+static void slab_unlink(slab_t* slab)
+{
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        slab->cache->partial = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = NULL;
+    slab->prev = NULL;
+}
+
+/**
+ * Allocate an object from a size class in O(1)
+ *
+ * @param cache: Size class cache
+ * @return: Pointer to object, or NULL if out of memory
+ */
+static void* slab_alloc(slab_cache_t* cache)
+{
+    slab_t* slab = cache->partial;
+    if (slab == NULL) {
+        slab = slab_grow(cache);
+        if (slab == NULL) {
+            return NULL;
+        }
+    }
+
+    void** object = (void**)slab->free;
+    slab->free = *object;
+    slab->inuse++;
+    cache->active++;
+    cache->allocs++;
+
+    // Full slabs leave the partial list
+    if (slab->free == NULL) {
+        slab_unlink(slab);
+    }
+
+    return object;
+}
+
+/**
+ * Return an object to its slab in O(1)
+ * Empty slabs are given back to the block allocator unless
+ * they are the cache's last partial slab
+ *
+ * @param slab: Slab owning the object
+ * @param ptr: Object to free
+ */
+static void slab_free(slab_t* slab, void* ptr)
+{
+    slab_cache_t* cache = slab->cache;
+
+    // Slab was full - make it partial again
+    if (slab->free == NULL) {
+        slab->prev = NULL;
+        slab->next = cache->partial;
+        if (cache->partial) {
+            cache->partial->prev = slab;
+        }
+        cache->partial = slab;
+    }
+
+    *(void**)ptr = slab->free;
+    slab->free = ptr;
+    slab->inuse--;
+    cache->active--;
+
+    if (slab->inuse == 0 && (slab->prev != NULL || slab->next != NULL)) {
+        slab_unlink(slab);
+        slab->cache = NULL;
+        cache->slabs--;
+
+        // The descriptor lives in the header of the chunk holding the page
+        heap_chunk_t* chunk = chunk_of(slab);
+        block_free((char*)chunk + (slab - chunk->slabs) * PAGE_SIZE);
+    }
+}
+
+/**
+ * Smallest page-run order that holds `size` bytes
+ *
+ * @param size: Size in bytes
+ * @return: Order (run of 2^order pages)
+ */
+static unsigned int page_order(unsigned int size)
+{
+    unsigned int order = 0;
+    while (((unsigned int)PAGE_SIZE << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+/**
+ * Allocate memory with a given alignment
+ * Small requests come from size-class slabs, larger ones from the free bins,
+ * and requests above HEAP_MAX_ALLOC get their own run of pages.
+ * Slab objects and page runs are naturally aligned to their size, so
+ * alignment only picks a bigger class or run. Heap blocks over-allocate
+ * by `align` and give the leading fragment back to the bins, so a small
+ * block with a large alignment does not cost a whole page run.
+ *
+ * @param size: Number of bytes to allocate
+ * @param align: Required alignment (power of two, at least BLOCK_ALIGN)
+ * @return: Pointer to allocated memory, or NULL if out of memory
+ */
+static void* heap_alloc(unsigned int size, unsigned int align)
 {
     if (!heap_initialized) {
         heap_init();
@@ -39,133 +578,233 @@ void* kmalloc(unsigned int size)
 
     if (size == 0) return NULL;
 
-    // Add header size and align to 4 bytes
-    unsigned int total_size = size + sizeof(block_header_t);
-    total_size = (total_size + 3) & ~3;  // Align to 4 bytes
-    
-    // Minimum block size
-    if (total_size < MIN_BLOCK_SIZE) {
-        total_size = MIN_BLOCK_SIZE;
-    }
-
-    block_header_t* current = free_list;
-    block_header_t* prev = NULL;
-
-    // First-fit: find first block large enough
-    while (current != NULL) {
-        if (current->free && current->size >= total_size) {
-            // Found a suitable block
-            
-            // If block is much larger, split it
-            if (current->size >= total_size + sizeof(block_header_t) + MIN_BLOCK_SIZE) {
-                // Split the block
-                block_header_t* new_block = (block_header_t*)((char*)current + total_size);
-                new_block->size = current->size - total_size;
-                new_block->free = 1;
-                new_block->next = current->next;
-                
-                current->size = total_size;
-                current->next = new_block;
-            } else {
-                // Remove from free list
-                if (prev) {
-                    prev->next = current->next;
-                } else {
-                    free_list = current->next;
-                }
-            }
+    void* ptr;
+    unsigned int granted;
 
-            // Mark as allocated
-            current->free = 0;
-            current->next = NULL;
+    if (size <= SLAB_MAX_SIZE && align <= SLAB_MAX_SIZE) {
+        slab_cache_t* cache = &slab_caches[slab_class(size > align ? size : align)];
+        ptr = slab_alloc(cache);
+        granted = cache->object_size;
+    } else if (size > HEAP_MAX_ALLOC || size + align > HEAP_MAX_ALLOC) {
+        // kfree recognises page runs by chunk alignment, so runs are at least a chunk
+        unsigned int order = page_order(size > align ? size : align);
+        if (order < HEAP_CHUNK_ORDER) {
+            order = HEAP_CHUNK_ORDER;
+        }
+        ptr = pmm_alloc_pages(order);
+        granted = (unsigned int)PAGE_SIZE << order;
+        if (ptr != NULL) {
+            page_bytes += granted;
+        }
+    } else {
+        ptr = block_alloc(size, align);
+        granted = 0;
+        if (ptr != NULL) {
+            block_header_t* block = (block_header_t*)((char*)ptr - sizeof(block_header_t));
+            granted = block->size - sizeof(block_header_t) - sizeof(block_footer_t);
+        }
+    }
 
-            // Return pointer to data (after header)
-            return (void*)((char*)current + sizeof(block_header_t));
+    if (ptr != NULL) {
+        bytes_in_use += granted;
+        if (bytes_in_use > peak_in_use) {
+            peak_in_use = bytes_in_use;
         }
-        
-        prev = current;
-        current = current->next;
     }
 
-    // No suitable block found
-    return NULL;
+    return ptr;
+}
+
+/**
+ * Allocate memory block
+ *
+ * @param size: Number of bytes to allocate
+ * @return: Pointer to allocated memory, or NULL if out of memory
+ */
+void* kmalloc(unsigned int size)
+{
+    return heap_alloc(size, BLOCK_ALIGN);
+}
+
+/**
+ * Allocate memory aligned to a power of two
+ *
+ * @param size: Number of bytes to allocate
+ * @param align: Alignment of the returned pointer (power of two, at most HEAP_SIZE)
+ * @return: Pointer to allocated memory, or NULL if out of memory or align is invalid
+ */
+void* kmalloc_aligned(unsigned int size, unsigned int align)
+{
+    if (align == 0 || (align & (align - 1)) != 0 || align > HEAP_SIZE) {
+        return NULL;
+    }
+
+    if (align < BLOCK_ALIGN) {
+        align = BLOCK_ALIGN;
+    }
+
+    return heap_alloc(size, align);
+}
+
+/**
+ * Allocate whole pages
+ * Runs up to HEAP_MAX_ALLOC are carved from the heap, larger ones
+ * come straight from the page-frame allocator
+ *
+ * @param count: Number of pages
+ * @return: Page-aligned pointer to count * PAGE_SIZE bytes, or NULL if out of memory
+ */
+void* kmalloc_pages(unsigned int count)
+{
+    if (count == 0 || count > (0xFFFFFFFFu >> PAGE_SHIFT)) {
+        return NULL;
+    }
+
+    return heap_alloc(count * PAGE_SIZE, PAGE_SIZE);
 }
 
 /**
  * Free allocated memory block
- * Coalesces adjacent free blocks to reduce fragmentation
- * 
+ *
  * @param ptr: Pointer to memory to free (must be from kmalloc)
  */
 void kfree(void* ptr)
 {
     if (ptr == NULL) return;
 
-    // Get block header
-    block_header_t* block = (block_header_t*)((char*)ptr - sizeof(block_header_t));
-    
-    if (block->free) {
-        // Already free - double free error
+    // Only page runs start on a chunk boundary (chunks begin with their header)
+    if (((unsigned long)ptr & (HEAP_SIZE - 1)) == 0) {
+        unsigned int bytes = pmm_free_pages(ptr) * PAGE_SIZE;
+        page_bytes -= bytes;
+        bytes_in_use -= bytes;
         return;
     }
 
-    block->free = 1;
+    slab_t* slab = slab_of(ptr);
+    if (slab->cache != NULL) {
+        bytes_in_use -= slab->cache->object_size;
+        slab_free(slab, ptr);
+        return;
+    }
+
+    bytes_in_use -= block_free(ptr);
+}
 
-    // Coalesce with adjacent free blocks
-    block_header_t* current = free_list;
-    block_header_t* prev = NULL;
+/**
+ * Resize an allocation
+ * Heap blocks are resized in place when the neighbouring memory allows;
+ * slab objects and page runs stay put while the new size still fits
+ * and is over half their size. Everything else moves to a fresh
+ * allocation (alignment beyond BLOCK_ALIGN is not preserved then).
+ *
+ * @param ptr: Allocation to resize (NULL acts like kmalloc)
+ * @param size: New size in bytes (0 frees ptr)
+ * @return: Pointer to the resized memory, or NULL if out of memory
+ */
+void* krealloc(void* ptr, unsigned int size)
+{
+    if (ptr == NULL) {
+        return kmalloc(size);
+    }
 
-    // Find insertion point in free list (sorted by address)
-    while (current != NULL && (char*)current < (char*)block) {
-        prev = current;
-        current = current->next;
+    if (size == 0) {
+        kfree(ptr);
+        return NULL;
     }
 
-    // Check if we can merge with previous block
-    if (prev != NULL) {
-        block_header_t* prev_end = (block_header_t*)((char*)prev + prev->size);
-        if (prev_end == block) {
-            // Merge with previous block
-            prev->size += block->size;
-            block = prev;
-        } else {
-            // Insert after previous
-            block->next = prev->next;
-            prev->next = block;
+    unsigned int old_size;
+    slab_t* slab = NULL;
+
+    if (((unsigned long)ptr & (HEAP_SIZE - 1)) == 0) {
+        old_size = pmm_run_pages(ptr) * PAGE_SIZE;
+        if (size <= old_size && size > old_size / 2) {
+            return ptr;
+        }
+    } else if ((slab = slab_of(ptr))->cache != NULL) {
+        old_size = slab->cache->object_size;
+        if (size <= old_size && (size > old_size / 2 || old_size == SLAB_MIN_SIZE)) {
+            return ptr;
         }
     } else {
-        // Insert at beginning
-        block->next = free_list;
-        free_list = block;
+        block_header_t* block = (block_header_t*)((char*)ptr - sizeof(block_header_t));
+        old_size = block->size - sizeof(block_header_t) - sizeof(block_footer_t);
+        if (block_resize(block, size) == 0) {
+            bytes_in_use += block->size - sizeof(block_header_t) - sizeof(block_footer_t);
+            bytes_in_use -= old_size;
+            if (bytes_in_use > peak_in_use) {
+                peak_in_use = bytes_in_use;
+            }
+            return ptr;
+        }
     }
 
-    // Check if we can merge with next block
-    block_header_t* block_end = (block_header_t*)((char*)block + block->size);
-    if (block->next != NULL && block_end == block->next) {
-        // Merge with next block
-        block->size += block->next->size;
-        block->next = block->next->next;
+    // Move to a new allocation
+    char* new_ptr = (char*)kmalloc(size);
+    if (new_ptr == NULL) {
+        return NULL;
     }
+
+    memcpy(new_ptr, ptr, (size < old_size) ? size : old_size);
+
+    kfree(ptr);
+    return new_ptr;
+}
+
+/**
+ * Free pages from kmalloc_pages
+ * Page allocations are ordinary heap allocations, so this is kfree
+ *
+ * @param ptr: Pointer returned by kmalloc_pages
+ */
+void kfree_pages(void* ptr)
+{
+    kfree(ptr);
 }
 
 /**
  * Get total allocated memory (for debugging)
- * 
+ * Counts what kmalloc handed out, rounded to the class or block size
+ *
  * @return: Total bytes currently allocated
  */
 unsigned int get_allocated_memory(void)
 {
-    unsigned int total = 0;
-    block_header_t* current = (block_header_t*)heap;
-    char* heap_end = heap + HEAP_SIZE;
+    return bytes_in_use;
+}
+
+/**
+ * Get heap statistics
+ * Everything is read from live counters except the largest free block,
+ * which only looks at the highest non-empty bin
+ *
+ * @param stats: Structure to fill
+ */
+void heap_get_stats(heap_stats_t* stats)
+{
+    if (stats == NULL) return;
 
-    while ((char*)current < heap_end) {
-        if (!current->free) {
-            total += current->size - sizeof(block_header_t);
+    stats->heap_size = chunk_count * HEAP_SIZE;
+    stats->in_use = bytes_in_use;
+    stats->peak = peak_in_use;
+    stats->free_bytes = free_bytes;
+    stats->free_blocks = free_blocks;
+    stats->page_bytes = page_bytes;
+
+    stats->largest_free = 0;
+    if (bin_map != 0) {
+        int top = bin_index(bin_map);  // Highest non-empty bin
+        for (block_header_t* block = bins[top]; block != NULL; block = block->next) {
+            if (block->size > stats->largest_free) {
+                stats->largest_free = block->size;
+            }
         }
-        current = (block_header_t*)((char*)current + current->size);
     }
 
-    return total;
+    stats->slab_pages = 0;
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        stats->slab_pages += slab_caches[i].slabs;
+        stats->class_size[i] = slab_caches[i].object_size;
+        stats->class_active[i] = slab_caches[i].active;
+        stats->class_allocs[i] = slab_caches[i].allocs;
+    }
 }
-
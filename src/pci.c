@@ -0,0 +1,195 @@
+#include "pci.h"
+#include "io.h"
+#include "source.h"
+
+/**
+ * Build a configuration address for mechanism #1
+ *
+ * @param bus: Bus number
+ * @param device: Device number
+ * @param function: Function number
+ * @param offset: Register offset
+ * @return: Value for the CONFIG_ADDRESS port
+ */
+static unsigned int pci_address(unsigned char bus, unsigned char device, unsigned char function, unsigned char offset)
+{
+    return 0x80000000u
+         | ((unsigned int)bus << 16)
+         | ((unsigned int)(device & 0x1F) << 11)
+         | ((unsigned int)(function & 0x07) << 8)
+         | (offset & 0xFC);
+}
+
+/**
+ * Read a configuration register by location
+ *
+ * @param bus: Bus number
+ * @param device: Device number
+ * @param function: Function number
+ * @param offset: Register offset
+ * @return: Register value
+ */
+static unsigned int pci_read(unsigned char bus, unsigned char device, unsigned char function, unsigned char offset)
+{
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, device, function, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+/**
+ * Read a 32-bit configuration register
+ *
+ * @param dev: Device
+ * @param offset: Register offset
+ * @return: Register value
+ */
+unsigned int pci_config_read(const pci_device_t* dev, unsigned char offset)
+{
+    return pci_read(dev->bus, dev->device, dev->function, offset);
+}
+
+/**
+ * Write a 32-bit configuration register
+ *
+ * @param dev: Device
+ * @param offset: Register offset
+ * @param value: Value to write
+ */
+void pci_config_write(const pci_device_t* dev, unsigned char offset, unsigned int value)
+{
+    outl(PCI_CONFIG_ADDRESS, pci_address(dev->bus, dev->device, dev->function, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+/**
+ * Read a base address register
+ *
+ * @param dev: Device
+ * @param bar: BAR number (0-5)
+ * @return: Raw BAR value, or 0 for an invalid BAR number
+ */
+unsigned int pci_read_bar(const pci_device_t* dev, int bar)
+{
+    if (bar < 0 || bar > 5) {
+        return 0;
+    }
+    return pci_config_read(dev, PCI_BAR0 + bar * 4);
+}
+
+// Match callback for pci_scan
+typedef int (*pci_match_t)(const pci_device_t* dev, unsigned int a, unsigned int b);
+
+/**
+ * Walk every function on every bus, returning the index'th match
+ *
+ * @param match: Predicate applied to each present function
+ * @param a: First predicate argument
+ * @param b: Second predicate argument
+ * @param index: Which match to return
+ * @param out: Filled in on success
+ * @return: 0 on success, -1 if there are not enough matches
+ */
+static int pci_scan(pci_match_t match, unsigned int a, unsigned int b, int index, pci_device_t* out)
+{
+    for (unsigned int bus = 0; bus < PCI_MAX_BUSES; bus++) {
+        for (unsigned char device = 0; device < PCI_MAX_DEVICES; device++) {
+            unsigned int id = pci_read(bus, device, 0, PCI_VENDOR_ID);
+            if ((id & 0xFFFF) == PCI_VENDOR_NONE) {
+                continue;
+            }
+
+            // Only multifunction devices have functions beyond 0
+            unsigned int header = pci_read(bus, device, 0, PCI_HEADER_TYPE);
+            unsigned char functions = (header & 0x00800000) ? PCI_MAX_FUNCTIONS : 1;
+
+            for (unsigned char function = 0; function < functions; function++) {
+                if (function > 0) {
+                    id = pci_read(bus, device, function, PCI_VENDOR_ID);
+                    if ((id & 0xFFFF) == PCI_VENDOR_NONE) {
+                        continue;
+                    }
+                }
+
+                unsigned int class_reg = pci_read(bus, device, function, PCI_CLASS);
+                pci_device_t dev;
+                dev.bus = bus;
+                dev.device = device;
+                dev.function = function;
+                dev.vendor_id = id & 0xFFFF;
+                dev.device_id = id >> 16;
+                dev.class_code = class_reg >> 24;
+                dev.subclass = (class_reg >> 16) & 0xFF;
+                dev.prog_if = (class_reg >> 8) & 0xFF;
+
+                if (match(&dev, a, b) && index-- == 0) {
+                    *out = dev;
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Match a device by class and subclass
+ */
+static int match_class(const pci_device_t* dev, unsigned int class_code, unsigned int subclass)
+{
+    return dev->class_code == class_code && dev->subclass == subclass;
+}
+
+/**
+ * Match a device by vendor and device ID
+ */
+static int match_id(const pci_device_t* dev, unsigned int vendor_id, unsigned int device_id)
+{
+    return dev->vendor_id == vendor_id && dev->device_id == device_id;
+}
+
+/**
+ * Find a device by class
+ *
+ * @param class_code: Base class
+ * @param subclass: Subclass
+ * @param index: Which match to return (0 for the first)
+ * @param dev: Filled in on success
+ * @return: 0 on success, -1 if there is no such device
+ */
+int pci_find_class(unsigned char class_code, unsigned char subclass, int index, pci_device_t* dev)
+{
+    if (dev == NULL) {
+        return -1;
+    }
+    return pci_scan(match_class, class_code, subclass, index, dev);
+}
+
+/**
+ * Find a device by vendor and device ID
+ *
+ * @param vendor_id: Vendor ID
+ * @param device_id: Device ID
+ * @param index: Which match to return (0 for the first)
+ * @param dev: Filled in on success
+ * @return: 0 on success, -1 if there is no such device
+ */
+int pci_find_device(unsigned short vendor_id, unsigned short device_id, int index, pci_device_t* dev)
+{
+    if (dev == NULL) {
+        return -1;
+    }
+    return pci_scan(match_id, vendor_id, device_id, index, dev);
+}
+
+/**
+ * Let a device decode its BARs and master the bus
+ *
+ * @param dev: Device
+ */
+void pci_enable_bus_master(const pci_device_t* dev)
+{
+    unsigned int command = pci_config_read(dev, PCI_COMMAND);
+    // Keep the status half zero: its bits are write-1-to-clear
+    command = (command & 0xFFFF) | PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_BUS_MASTER;
+    pci_config_write(dev, PCI_COMMAND, command);
+}
@@ -0,0 +1,542 @@
+#include "pmm.h"
+#include "source.h"
+
+// Free run node, stored in the first page of every free run
+typedef struct free_run {
+    struct free_run* next;
+    struct free_run* prev;
+} free_run_t;
+
+// Regions that must never be handed out even if the memory map
+// reports them as available (boot information, frame descriptors)
+#define PMM_MAX_HOLES 4
+
+typedef struct {
+    unsigned long start;
+    unsigned long end;
+} pmm_range_t;
+
+// Page-frame allocator state
+static page_frame_t* frames = NULL;   // One descriptor per frame from base_pfn
+static unsigned long base_pfn = 0;    // Frame number of frames[0]
+static unsigned int frame_count = 0;  // Number of descriptors
+static free_run_t* free_areas[PMM_MAX_ORDER + 1];  // Free runs by order
+static unsigned int total_pages = 0;
+static unsigned int free_pages = 0;
+static pmm_range_t holes[PMM_MAX_HOLES];
+static int hole_count = 0;
+
+/**
+ * Get the address of a frame
+ *
+ * @param index: Frame index (relative to base_pfn)
+ * @return: Address of the frame
+ */
+static void* frame_addr(unsigned int index)
+{
+    return (void*)((base_pfn + index) << PAGE_SHIFT);
+}
+
+/**
+ * Push a free run onto its order's list
+ *
+ * @param index: Index of the run's first frame
+ * @param order: Run size as a power of two
+ */
+static void free_area_push(unsigned int index, unsigned int order)
+{
+    free_run_t* run = (free_run_t*)frame_addr(index);
+    run->prev = NULL;
+    run->next = free_areas[order];
+    if (free_areas[order]) {
+        free_areas[order]->prev = run;
+    }
+    free_areas[order] = run;
+
+    frames[index].flags = PAGE_FREE;
+    frames[index].order = order;
+}
+
+/**
+ * Unlink a free run from its order's list
+ *
+ * @param index: Index of the run's first frame
+ * @param order: Run size as a power of two
+ */
+static void free_area_remove(unsigned int index, unsigned int order)
+{
+    free_run_t* run = (free_run_t*)frame_addr(index);
+    if (run->prev) {
+        run->prev->next = run->next;
+    } else {
+        free_areas[order] = run->next;
+    }
+    if (run->next) {
+        run->next->prev = run->prev;
+    }
+
+    frames[index].flags = 0;
+}
+
+/**
+ * Return a run to the free lists, merging with its buddy while possible
+ *
+ * @param index: Index of the run's first frame
+ * @param order: Run size as a power of two
+ */
+static void buddy_free(unsigned int index, unsigned int order)
+{
+    free_pages += 1u << order;
+
+    while (order < PMM_MAX_ORDER) {
+        unsigned int buddy = index ^ (1u << order);
+        if (buddy >= frame_count ||
+            !(frames[buddy].flags & PAGE_FREE) || frames[buddy].order != order) {
+            break;
+        }
+
+        free_area_remove(buddy, order);
+        index &= ~(1u << order);
+        order++;
+    }
+
+    free_area_push(index, order);
+}
+
+/**
+ * Set up the frame descriptor table
+ * All frames start out reserved until released
+ *
+ * @param highest: Highest address that may be managed (exclusive)
+ * @param store: Where to put the descriptor table
+ */
+static void frames_setup(unsigned long highest, unsigned long store)
+{
+    frames = (page_frame_t*)store;
+    frame_count = (highest >> PAGE_SHIFT) - base_pfn;
+
+    for (unsigned int i = 0; i < frame_count; i++) {
+        frames[i].flags = PAGE_RESERVED;
+        frames[i].order = 0;
+    }
+
+    for (int i = 0; i <= PMM_MAX_ORDER; i++) {
+        free_areas[i] = NULL;
+    }
+    total_pages = 0;
+    free_pages = 0;
+}
+
+/**
+ * Base frame number for a managed range
+ * Aligned down to the largest run so that buddies computed from
+ * relative indices are also naturally aligned in physical memory
+ *
+ * @param lowest: Lowest address that may be managed
+ * @return: Frame number of the first descriptor
+ */
+static unsigned long frames_base(unsigned long lowest)
+{
+    return (lowest >> PAGE_SHIFT) & ~((1ul << PMM_MAX_ORDER) - 1);
+}
+
+/**
+ * Free an arbitrary range of frames
+ * Uses the largest naturally aligned runs that fit
+ *
+ * @param index: First frame
+ * @param limit: End frame (exclusive)
+ */
+static void free_frames(unsigned int index, unsigned int limit)
+{
+    while (index < limit) {
+        unsigned int order = 0;
+        while (order < PMM_MAX_ORDER &&
+               (index & ((2u << order) - 1)) == 0 &&
+               index + (2u << order) <= limit) {
+            order++;
+        }
+
+        buddy_free(index, order);
+        index += 1u << order;
+    }
+}
+
+/**
+ * Record a region that must not be released
+ *
+ * @param start: Start address
+ * @param end: End address (exclusive)
+ */
+static void add_hole(unsigned long start, unsigned long end)
+{
+    if (hole_count >= PMM_MAX_HOLES || end <= start) {
+        return;
+    }
+    holes[hole_count].start = start & ~(unsigned long)(PAGE_SIZE - 1);
+    holes[hole_count].end = (end + PAGE_SIZE - 1) & ~(unsigned long)(PAGE_SIZE - 1);
+    hole_count++;
+}
+
+/**
+ * Hand a range of available memory to the allocator
+ * Skips holes and pages outside the descriptor table
+ *
+ * @param start: Start address
+ * @param end: End address (exclusive)
+ */
+static void release_range(unsigned long start, unsigned long end)
+{
+    start = (start + PAGE_SIZE - 1) & ~(unsigned long)(PAGE_SIZE - 1);
+    end &= ~(unsigned long)(PAGE_SIZE - 1);
+    if (end <= start) {
+        return;
+    }
+
+    // Split around the first hole that overlaps the range
+    for (int i = 0; i < hole_count; i++) {
+        if (holes[i].start < end && holes[i].end > start) {
+            release_range(start, holes[i].start);
+            release_range(holes[i].end, end);
+            return;
+        }
+    }
+
+    unsigned long first = start >> PAGE_SHIFT;
+    unsigned long last = end >> PAGE_SHIFT;
+    if (first < base_pfn) {
+        first = base_pfn;
+    }
+    if (last > base_pfn + frame_count) {
+        last = base_pfn + frame_count;
+    }
+    if (last <= first) {
+        return;
+    }
+
+    unsigned int index = first - base_pfn;
+    unsigned int limit = last - base_pfn;
+
+    for (unsigned int i = index; i < limit; i++) {
+        frames[i].flags = 0;
+    }
+
+    total_pages += limit - index;
+    free_frames(index, limit);
+}
+
+/**
+ * Initialize from the multiboot memory map
+ *
+ * @param mbi: Boot information from the bootloader
+ * @param reserved_end: End address of the kernel image
+ * @return: 0 on success, -1 on error
+ */
+int pmm_init(multiboot_info_t* mbi, unsigned long reserved_end)
+{
+    if (mbi == NULL) {
+        return -1;
+    }
+
+    // No memory map - fall back to the single upper memory region
+    if (!(mbi->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        if (!(mbi->flags & MULTIBOOT_INFO_MEMORY)) {
+            return -1;
+        }
+        return pmm_init_range(reserved_end, 0x100000 + (unsigned long)mbi->mem_upper * 1024);
+    }
+
+    // Keep the boot information itself out of the free pool
+    hole_count = 0;
+    add_hole((unsigned long)mbi, (unsigned long)mbi + sizeof(multiboot_info_t));
+    add_hole(mbi->mmap_addr, mbi->mmap_addr + mbi->mmap_length);
+    if (mbi->flags & MULTIBOOT_INFO_CMDLINE) {
+        add_hole(mbi->cmdline, mbi->cmdline + PAGE_SIZE);
+    }
+
+    unsigned long mmap_start = mbi->mmap_addr;
+    unsigned long mmap_end = mmap_start + mbi->mmap_length;
+    multiboot_mmap_entry_t* entry;
+
+    // First pass: find the top of available memory (below 4GB)
+    unsigned long highest = 0;
+    for (unsigned long addr = mmap_start; addr < mmap_end; addr += entry->size + sizeof(entry->size)) {
+        entry = (multiboot_mmap_entry_t*)addr;
+        if (entry->type != MULTIBOOT_MEMORY_AVAILABLE || entry->base_high != 0) {
+            continue;
+        }
+
+        unsigned long long end = (unsigned long long)entry->base_low + entry->length_low +
+                                 ((unsigned long long)entry->length_high << 32);
+        if (end > 0xFFFFF000ull) {
+            end = 0xFFFFF000ull;
+        }
+        if ((unsigned long)end > highest) {
+            highest = (unsigned long)end;
+        }
+    }
+
+    if (highest <= reserved_end) {
+        return -1;
+    }
+
+    // Second pass: place the descriptor table in the first region that holds it
+    base_pfn = frames_base(reserved_end);
+    unsigned long table_size = ((highest >> PAGE_SHIFT) - base_pfn) * sizeof(page_frame_t);
+    unsigned long store = 0;
+    for (unsigned long addr = mmap_start; addr < mmap_end; addr += entry->size + sizeof(entry->size)) {
+        entry = (multiboot_mmap_entry_t*)addr;
+        if (entry->type != MULTIBOOT_MEMORY_AVAILABLE || entry->base_high != 0) {
+            continue;
+        }
+
+        unsigned long start = entry->base_low;
+        if (start < reserved_end) {
+            start = reserved_end;
+        }
+        start = (start + PAGE_SIZE - 1) & ~(unsigned long)(PAGE_SIZE - 1);
+
+        int overlaps = 0;
+        for (int i = 0; i < hole_count; i++) {
+            if (holes[i].start < start + table_size && holes[i].end > start) {
+                overlaps = 1;
+            }
+        }
+
+        if (!overlaps && start + table_size <= entry->base_low + entry->length_low) {
+            store = start;
+            break;
+        }
+    }
+
+    if (store == 0) {
+        return -1;
+    }
+
+    frames_setup(highest, store);
+    add_hole(store, store + table_size);
+
+    // Third pass: release every available region above the kernel
+    for (unsigned long addr = mmap_start; addr < mmap_end; addr += entry->size + sizeof(entry->size)) {
+        entry = (multiboot_mmap_entry_t*)addr;
+        if (entry->type != MULTIBOOT_MEMORY_AVAILABLE || entry->base_high != 0) {
+            continue;
+        }
+
+        unsigned long start = entry->base_low;
+        unsigned long end = start + entry->length_low;
+        if (end < start || entry->length_high != 0) {
+            end = 0xFFFFF000ul;  // Region runs past 4GB
+        }
+        if (start < reserved_end) {
+            start = reserved_end;
+        }
+        release_range(start, end);
+    }
+
+    return 0;
+}
+
+/**
+ * Initialize over a single contiguous range of available memory
+ * The descriptor table is placed at the start of the range
+ *
+ * @param start: Start address of the range
+ * @param end: End address of the range (exclusive)
+ * @return: 0 on success, -1 on error
+ */
+int pmm_init_range(unsigned long start, unsigned long end)
+{
+    start = (start + PAGE_SIZE - 1) & ~(unsigned long)(PAGE_SIZE - 1);
+    end &= ~(unsigned long)(PAGE_SIZE - 1);
+
+    base_pfn = frames_base(start);
+    unsigned long table_size = ((end >> PAGE_SHIFT) - base_pfn) * sizeof(page_frame_t);
+    if (end <= start || start + table_size >= end) {
+        return -1;
+    }
+
+    frames_setup(end, start);
+    release_range(start + table_size, end);
+
+    return 0;
+}
+
+/**
+ * Allocate 2^order contiguous pages
+ * Takes the smallest free run that fits and splits it down
+ *
+ * @param order: Run size as a power of two (0 = one page)
+ * @return: Address of the first page, or NULL if out of memory
+ */
+void* pmm_alloc_pages(unsigned int order)
+{
+    if (frames == NULL || order > PMM_MAX_ORDER) {
+        return NULL;
+    }
+
+    unsigned int current = order;
+    while (current <= PMM_MAX_ORDER && free_areas[current] == NULL) {
+        current++;
+    }
+    if (current > PMM_MAX_ORDER) {
+        return NULL;  // Out of memory
+    }
+
+    unsigned int index = ((unsigned long)free_areas[current] >> PAGE_SHIFT) - base_pfn;
+    free_area_remove(index, current);
+
+    // Give back the upper halves until the run is the right size
+    while (current > order) {
+        current--;
+        free_area_push(index + (1u << current), current);
+    }
+
+    frames[index].flags = PAGE_ALLOCATED;
+    frames[index].order = order;
+    free_pages -= 1u << order;
+
+    return frame_addr(index);
+}
+
+/**
+ * Allocate a physically contiguous range of any number of pages
+ * Takes the range from the top of the highest free span that holds it,
+ * which may cross several buddy runs. O(number of frames), meant for
+ * boot-time carve-outs such as the ramdisk.
+ *
+ * @param pages: Number of pages
+ * @return: Address of the first page, or NULL if no span is large enough
+ */
+void* pmm_alloc_contiguous(unsigned int pages)
+{
+    if (frames == NULL || pages == 0) {
+        return NULL;
+    }
+
+    // Find the highest span of adjacent free runs that is large enough
+    unsigned int span_start = 0, span_end = 0;
+    unsigned int best_end = 0;
+    unsigned int i = 0;
+    while (i < frame_count) {
+        unsigned int step = 1;
+        if (frames[i].flags & (PAGE_FREE | PAGE_ALLOCATED)) {
+            step = 1u << frames[i].order;
+        }
+
+        if (frames[i].flags & PAGE_FREE) {
+            if (span_end != i) {
+                span_start = i;
+            }
+            span_end = i + step;
+            if (span_end - span_start >= pages) {
+                best_end = span_end;
+            }
+        }
+        i += step;
+    }
+
+    if (best_end == 0) {
+        return NULL;
+    }
+
+    unsigned int start = best_end - pages;
+
+    // Pull every run overlapping the range off the free lists,
+    // then give back the parts of them outside the range
+    i = start;
+    while (i > 0 && !(frames[i].flags & PAGE_FREE)) {
+        i--;  // Find the head of the run containing start
+    }
+    while (i < best_end) {
+        unsigned int order = frames[i].order;
+        unsigned int run_end = i + (1u << order);
+
+        free_area_remove(i, order);
+        free_pages -= 1u << order;
+
+        if (i < start) {
+            free_frames(i, start);
+        }
+        if (run_end > best_end) {
+            free_frames(best_end, run_end);
+        }
+        i = run_end;
+    }
+
+    for (i = start; i < best_end; i++) {
+        frames[i].flags = PAGE_RESERVED;
+    }
+
+    return frame_addr(start);
+}
+
+/**
+ * Free a run returned by pmm_alloc_pages
+ *
+ * @param addr: Address of the first page of the run
+ * @return: Number of pages freed (0 if addr is not an allocated run)
+ */
+unsigned int pmm_free_pages(void* addr)
+{
+    if (frames == NULL || addr == NULL) {
+        return 0;
+    }
+
+    unsigned long pfn = (unsigned long)addr >> PAGE_SHIFT;
+    if (pfn < base_pfn || pfn >= base_pfn + frame_count) {
+        return 0;  // Not managed here
+    }
+
+    unsigned int index = pfn - base_pfn;
+    if (!(frames[index].flags & PAGE_ALLOCATED)) {
+        return 0;  // Not the head of an allocated run (or double free)
+    }
+
+    unsigned int order = frames[index].order;
+    frames[index].flags = 0;
+    buddy_free(index, order);
+
+    return 1u << order;
+}
+
+/**
+ * Get the size of an allocated run
+ *
+ * @param addr: Address of the first page of the run
+ * @return: Number of pages in the run (0 if addr is not an allocated run)
+ */
+unsigned int pmm_run_pages(void* addr)
+{
+    if (frames == NULL || addr == NULL) {
+        return 0;
+    }
+
+    unsigned long pfn = (unsigned long)addr >> PAGE_SHIFT;
+    if (pfn < base_pfn || pfn >= base_pfn + frame_count) {
+        return 0;  // Not managed here
+    }
+
+    unsigned int index = pfn - base_pfn;
+    if (!(frames[index].flags & PAGE_ALLOCATED)) {
+        return 0;
+    }
+
+    return 1u << frames[index].order;
+}
+
+/**
+ * Get page-frame allocator information
+ *
+ * @param total: Pointer to store number of managed pages (can be NULL)
+ * @param free: Pointer to store number of free pages (can be NULL)
+ */
+void pmm_get_info(unsigned int* total, unsigned int* free)
+{
+    if (total != NULL) {
+        *total = total_pages;
+    }
+    if (free != NULL) {
+        *free = free_pages;
+    }
+}
@@ -1,173 +1,711 @@
 #include "ramdisk.h"
 #include "source.h"
+#include "lz.h"
+#include "io.h"
 
-// Global RAM disk instance
-static ramdisk_t g_ramdisk;
+// RAM disk instances (the boot disk is always first)
+static ramdisk_t g_ramdisks[RAMDISK_MAX_DISKS];
+static unsigned int requested_size = 0;  // From the boot command line (0 = default)
+static int compression_enabled = 0;      // New disks use compressed mode
 
 /**
- * Initialize RAM disk
- * Allocates memory for the disk and initializes the structure
- * 
- * @return: 0 on success, -1 on failure
+ * Set the RAM disk size
+ * Must be called before ramdisk_init
+ *
+ * @param size: Disk size in bytes (0 = default)
  */
-int ramdisk_init(void)
+void ramdisk_set_size(unsigned int size)
 {
-    if (g_ramdisk.initialized) {
-        return 0;  // Already initialized
+    requested_size = size;
+}
+
+/**
+ * Select compressed mode for RAM disks created from now on
+ *
+ * @param enabled: Non-zero to compress
+ */
+void ramdisk_set_compression(int enabled)
+{
+    compression_enabled = enabled;
+}
+
+/**
+ * Check whether a block has ever been written
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number
+ * @return: Non-zero if the block's backing memory holds its contents
+ */
+static int block_written(ramdisk_t* disk, unsigned int block_num)
+{
+    if (disk->written == NULL) {
+        return 1;
     }
+    return disk->written[block_num / 32] & (1u << (block_num % 32));
+}
 
-    // Allocate memory for disk
-    g_ramdisk.data = (unsigned char*)kmalloc(RAMDISK_SIZE);
-    if (g_ramdisk.data == NULL) {
-        return -1;  // Out of memory
+/**
+ * Record that a block's backing memory now holds its contents
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number
+ */
+static void mark_written(ramdisk_t* disk, unsigned int block_num)
+{
+    if (disk->written != NULL) {
+        disk->written[block_num / 32] |= 1u << (block_num % 32);
     }
+}
 
-    // Initialize disk structure
-    g_ramdisk.size = RAMDISK_SIZE;
-    g_ramdisk.block_count = RAMDISK_BLOCKS;
-    g_ramdisk.initialized = 1;
+/**
+ * Read blocks from a RAM disk
+ * Never-written blocks are returned as zeros
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param count: Number of blocks to read
+ * @param buffer: Buffer to store data (must be count * BLOCK_SIZE bytes)
+ * @return: 0 on success
+ */
+static int ramdisk_read(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
 
-    // Zero out the disk (simulate fresh disk)
-    for (unsigned int i = 0; i < RAMDISK_SIZE; i++) {
-        g_ramdisk.data[i] = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (block_written(disk, start_block + i)) {
+            memcpy(buffer + i * BLOCK_SIZE, disk->data + (start_block + i) * BLOCK_SIZE, BLOCK_SIZE);
+        } else {
+            memset(buffer + i * BLOCK_SIZE, 0, BLOCK_SIZE);
+        }
     }
 
     return 0;
 }
 
 /**
- * Read a single block from RAM disk
- * 
- * @param block_num: Block number (0-indexed)
- * @param buffer: Buffer to store data (must be at least BLOCK_SIZE bytes)
- * @return: 0 on success, -1 on error
+ * Write blocks to a RAM disk
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param count: Number of blocks to write
+ * @param buffer: Data to write (must be count * BLOCK_SIZE bytes)
+ * @return: 0 on success
  */
-int ramdisk_read_block(unsigned int block_num, unsigned char* buffer)
+static int ramdisk_write(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
 {
-    if (!g_ramdisk.initialized) {
-        return -1;
-    }
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
 
-    if (block_num >= g_ramdisk.block_count) {
-        return -1;  // Block out of range
+    // Blocks are contiguous in memory - copy them in one go
+    memcpy(disk->data + start_block * BLOCK_SIZE, buffer, count * BLOCK_SIZE);
+    for (unsigned int i = 0; i < count; i++) {
+        mark_written(disk, start_block + i);
     }
 
-    if (buffer == NULL) {
-        return -1;  // Invalid buffer
+    return 0;
+}
+
+/**
+ * Discard blocks
+ * Backing memory is re-zeroed lazily: clearing a block's written bit is
+ * enough for it to read as zeros. Without the bitmap it is zeroed now.
+ *
+ * @param dev: Block device
+ * @param start_block: First block to discard
+ * @param count: Number of blocks
+ * @return: 0 on success
+ */
+static int ramdisk_discard(block_device_t* dev, unsigned int start_block, unsigned int count)
+{
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
+
+    if (disk->written == NULL) {
+        memset(disk->data + start_block * BLOCK_SIZE, 0, count * BLOCK_SIZE);
+        return 0;
     }
 
-    // Calculate offset in disk
-    unsigned int offset = block_num * BLOCK_SIZE;
+    unsigned int block = start_block;
+    unsigned int end = start_block + count;
 
-    // Copy block data to buffer
-    for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-        buffer[i] = g_ramdisk.data[offset + i];
+    // Partial words at the edges bit by bit, whole words in between
+    while (block < end && (block % 32) != 0) {
+        disk->written[block / 32] &= ~(1u << (block % 32));
+        block++;
+    }
+    while (end - block >= 32) {
+        disk->written[block / 32] = 0;
+        block += 32;
+    }
+    while (block < end) {
+        disk->written[block / 32] &= ~(1u << (block % 32));
+        block++;
     }
 
     return 0;
 }
 
 /**
- * Write a single block to RAM disk
- * 
+ * Get a direct pointer to a block's backing memory
+ * A never-written block is only mapped for a caller about to overwrite
+ * it; a reader gets NULL and reads the zeros through ramdisk_read, so
+ * the backing memory stays untouched
+ *
+ * @param dev: Block device
  * @param block_num: Block number (0-indexed)
- * @param buffer: Data to write (must be BLOCK_SIZE bytes)
- * @return: 0 on success, -1 on error
+ * @param write: Non-zero if the caller will overwrite the block
+ * @return: Pointer to BLOCK_SIZE bytes, or NULL
  */
-int ramdisk_write_block(unsigned int block_num, unsigned char* buffer)
+static unsigned char* ramdisk_map(block_device_t* dev, unsigned int block_num, int write)
 {
-    if (!g_ramdisk.initialized) {
-        return -1;
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
+
+    unsigned char* block = disk->data + block_num * BLOCK_SIZE;
+    if (!block_written(disk, block_num)) {
+        if (!write) {
+            return NULL;
+        }
+        mark_written(disk, block_num);  // The caller fills all of it
+    }
+
+    return block;
+}
+
+// RAM disk driver (memory needs no flush, and mappings no bookkeeping)
+static const block_driver_t ramdisk_driver = {
+    .name = "ramdisk",
+    .persistent = 0,
+    .read = ramdisk_read,
+    .write = ramdisk_write,
+    .readv = NULL,
+    .writev = NULL,
+    .flush = NULL,
+    .discard = ramdisk_discard,
+    .map = ramdisk_map,
+    .unmap = NULL,
+};
+
+// ----------------------------------------------------------------------------
+// Compressed mode
+// ----------------------------------------------------------------------------
+
+/**
+ * Check whether a block is all zeros
+ *
+ * @param data: Block (BLOCK_SIZE bytes, word aligned)
+ * @return: Non-zero if every byte is zero
+ */
+static int block_is_zero(const unsigned char* data)
+{
+    const unsigned int* words = (const unsigned int*)data;
+    for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(unsigned int); i++) {
+        if (words[i] != 0) {
+            return 0;
+        }
     }
+    return 1;
+}
 
-    if (block_num >= g_ramdisk.block_count) {
-        return -1;  // Block out of range
+/**
+ * Drop a block's stored form
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number
+ */
+static void stored_free(ramdisk_t* disk, unsigned int block_num)
+{
+    if (disk->blocks[block_num] == NULL) {
+        return;
     }
 
-    if (buffer == NULL) {
-        return -1;  // Invalid buffer
+    disk->stats.stored_blocks--;
+    disk->stats.stored_bytes -= disk->lengths[block_num];
+    if (disk->lengths[block_num] == BLOCK_SIZE) {
+        disk->stats.raw_blocks--;
     }
 
-    // Calculate offset in disk
-    unsigned int offset = block_num * BLOCK_SIZE;
+    kfree(disk->blocks[block_num]);
+    disk->blocks[block_num] = NULL;
+    disk->lengths[block_num] = 0;
+}
 
-    // Copy buffer data to disk
-    for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-        g_ramdisk.data[offset + i] = buffer[i];
+/**
+ * Replace a block's stored form with new contents
+ * All-zero blocks are stored as a NULL pointer; blocks that do not
+ * compress below RAMDISK_RAW_LIMIT are stored raw
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number
+ * @param data: New contents (BLOCK_SIZE bytes)
+ * @return: 0 on success, -1 if out of memory
+ */
+static int stored_put(ramdisk_t* disk, unsigned int block_num, const unsigned char* data)
+{
+    if (block_is_zero(data)) {
+        stored_free(disk, block_num);
+        disk->stats.zero_stores++;
+        return 0;
+    }
+
+    unsigned char* packed = disk->packed;
+    unsigned long long start = rdtsc();
+    unsigned int length = lz_compress(disk->lz, data, BLOCK_SIZE, packed, RAMDISK_RAW_LIMIT);
+    disk->stats.compress_cycles += rdtsc() - start;
+    disk->stats.compressions++;
+
+    const unsigned char* source = packed;
+    if (length == 0) {
+        source = data;  // Did not shrink enough - keep it raw
+        length = BLOCK_SIZE;
     }
 
+    unsigned char* copy = (unsigned char*)kmalloc(length);
+    if (copy == NULL) {
+        return -1;  // Old contents stay in place
+    }
+    memcpy(copy, source, length);
+
+    stored_free(disk, block_num);
+    disk->blocks[block_num] = copy;
+    disk->lengths[block_num] = length;
+    disk->stats.stored_blocks++;
+    disk->stats.stored_bytes += length;
+    if (length == BLOCK_SIZE) {
+        disk->stats.raw_blocks++;
+    }
     return 0;
 }
 
 /**
- * Read multiple blocks from RAM disk
- * 
+ * Expand a block's stored form
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number
+ * @param data: Destination (BLOCK_SIZE bytes)
+ * @return: 0 on success, -1 if the stored form is corrupt
+ */
+static int stored_get(ramdisk_t* disk, unsigned int block_num, unsigned char* data)
+{
+    unsigned char* stored = disk->blocks[block_num];
+
+    if (stored == NULL) {
+        memset(data, 0, BLOCK_SIZE);
+        return 0;
+    }
+    if (disk->lengths[block_num] == BLOCK_SIZE) {
+        memcpy(data, stored, BLOCK_SIZE);
+        return 0;
+    }
+
+    unsigned long long start = rdtsc();
+    int result = lz_decompress(stored, disk->lengths[block_num], data, BLOCK_SIZE);
+    disk->stats.decompress_cycles += rdtsc() - start;
+    disk->stats.decompressions++;
+    return result;
+}
+
+/**
+ * Find a block in the hot cache
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number
+ * @return: Entry, or NULL on a miss
+ */
+static ramdisk_hot_t* hot_find(ramdisk_t* disk, unsigned int block_num)
+{
+    for (int i = 0; i < RAMDISK_HOT_BLOCKS; i++) {
+        if (disk->hot[i].valid && disk->hot[i].block == block_num) {
+            disk->hot[i].last_use = ++disk->hot_tick;
+            disk->stats.hot_hits++;
+            return &disk->hot[i];
+        }
+    }
+    disk->stats.hot_misses++;
+    return NULL;
+}
+
+/**
+ * Take a hot cache entry for a block, writing back the one it replaces
+ *
+ * @param disk: RAM disk
+ * @param block_num: Block number the entry will hold
+ * @return: Entry (contents undefined), or NULL if the writeback failed
+ */
+static ramdisk_hot_t* hot_claim(ramdisk_t* disk, unsigned int block_num)
+{
+    ramdisk_hot_t* victim = &disk->hot[0];
+    for (int i = 0; i < RAMDISK_HOT_BLOCKS; i++) {
+        if (!disk->hot[i].valid) {
+            victim = &disk->hot[i];
+            break;
+        }
+        if (disk->hot[i].last_use < victim->last_use) {
+            victim = &disk->hot[i];
+        }
+    }
+
+    if (victim->valid && victim->dirty && stored_put(disk, victim->block, victim->data) != 0) {
+        return NULL;
+    }
+
+    victim->block = block_num;
+    victim->valid = 1;
+    victim->dirty = 0;
+    victim->last_use = ++disk->hot_tick;
+    return victim;
+}
+
+/**
+ * Read blocks from a compressed RAM disk
+ *
+ * @param dev: Block device
  * @param start_block: Starting block number
  * @param count: Number of blocks to read
  * @param buffer: Buffer to store data (must be count * BLOCK_SIZE bytes)
  * @return: 0 on success, -1 on error
  */
-int ramdisk_read_blocks(unsigned int start_block, unsigned int count, unsigned char* buffer)
+static int ramdisk_lz_read(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
 {
-    if (!g_ramdisk.initialized || buffer == NULL) {
-        return -1;
-    }
-
-    if (start_block + count > g_ramdisk.block_count) {
-        return -1;  // Blocks out of range
-    }
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
 
-    // Read each block
     for (unsigned int i = 0; i < count; i++) {
-        if (ramdisk_read_block(start_block + i, buffer + (i * BLOCK_SIZE)) != 0) {
-            return -1;
+        unsigned int block_num = start_block + i;
+        ramdisk_hot_t* hot = hot_find(disk, block_num);
+
+        if (hot == NULL) {
+            // Keep the block uncompressed for the next access
+            hot = hot_claim(disk, block_num);
+            if (hot == NULL) {
+                if (stored_get(disk, block_num, buffer + i * BLOCK_SIZE) != 0) {
+                    return -1;
+                }
+                continue;
+            }
+            if (stored_get(disk, block_num, hot->data) != 0) {
+                hot->valid = 0;
+                return -1;
+            }
         }
+
+        memcpy(buffer + i * BLOCK_SIZE, hot->data, BLOCK_SIZE);
     }
 
     return 0;
 }
 
 /**
- * Write multiple blocks to RAM disk
- * 
+ * Write blocks to a compressed RAM disk
+ * Blocks land in the hot cache and are compressed when they leave it
+ *
+ * @param dev: Block device
  * @param start_block: Starting block number
  * @param count: Number of blocks to write
  * @param buffer: Data to write (must be count * BLOCK_SIZE bytes)
- * @return: 0 on success, -1 on error
+ * @return: 0 on success, -1 if out of memory
+ */
+static int ramdisk_lz_write(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
+
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int block_num = start_block + i;
+        ramdisk_hot_t* hot = hot_find(disk, block_num);
+
+        if (hot == NULL) {
+            hot = hot_claim(disk, block_num);
+            if (hot == NULL) {
+                // Cache cannot take it: store directly
+                if (stored_put(disk, block_num, buffer + i * BLOCK_SIZE) != 0) {
+                    return -1;
+                }
+                continue;
+            }
+        }
+
+        memcpy(hot->data, buffer + i * BLOCK_SIZE, BLOCK_SIZE);
+        hot->dirty = 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Discard blocks on a compressed RAM disk
+ * Their storage is freed at once, so they read as zeros again
+ *
+ * @param dev: Block device
+ * @param start_block: First block to discard
+ * @param count: Number of blocks
+ * @return: 0 on success
+ */
+static int ramdisk_lz_discard(block_device_t* dev, unsigned int start_block, unsigned int count)
+{
+    ramdisk_t* disk = (ramdisk_t*)dev->driver_data;
+
+    for (int i = 0; i < RAMDISK_HOT_BLOCKS; i++) {
+        if (disk->hot[i].valid && disk->hot[i].block - start_block < count) {
+            disk->hot[i].valid = 0;
+        }
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        stored_free(disk, start_block + i);
+    }
+
+    return 0;
+}
+
+// Compressed RAM disk driver (blocks have no fixed address, so no map)
+static const block_driver_t ramdisk_lz_driver = {
+    .name = "ramdisk-lz",
+    .persistent = 0,
+    .read = ramdisk_lz_read,
+    .write = ramdisk_lz_write,
+    .readv = NULL,
+    .writev = NULL,
+    .flush = NULL,
+    .discard = ramdisk_lz_discard,
+    .map = NULL,
+    .unmap = NULL,
+};
+
+/**
+ * Free the tables of a compressed RAM disk that failed to attach
+ *
+ * @param disk: Disk structure
+ * @param hot_data: Hot cache memory (can be NULL)
  */
-int ramdisk_write_blocks(unsigned int start_block, unsigned int count, unsigned char* buffer)
+static void ramdisk_free_compressed(ramdisk_t* disk, unsigned char* hot_data)
 {
-    if (!g_ramdisk.initialized || buffer == NULL) {
+    kfree(hot_data);
+    kfree(disk->blocks);
+    kfree(disk->lengths);
+    kfree(disk->lz);
+    kfree(disk->packed);
+    disk->blocks = NULL;
+    disk->lengths = NULL;
+    disk->lz = NULL;
+    disk->packed = NULL;
+}
+
+/**
+ * Set up a compressed RAM disk and register it
+ * Only the per-block tables, the hot cache and the compressor's working
+ * memory are allocated up front; block storage comes from the heap as
+ * blocks are written
+ *
+ * @param disk: Disk structure to fill
+ * @param size: Disk size in bytes
+ * @return: Block device number, or -1 on error
+ */
+static int ramdisk_attach_compressed(ramdisk_t* disk, unsigned int size)
+{
+    unsigned int block_count = size / BLOCK_SIZE;
+    unsigned char* hot_data = (unsigned char*)kmalloc_aligned(RAMDISK_HOT_BLOCKS * BLOCK_SIZE, CACHE_LINE_SIZE);
+    disk->blocks = (unsigned char**)kmalloc(block_count * sizeof(unsigned char*));
+    disk->lengths = (unsigned short*)kmalloc(block_count * sizeof(unsigned short));
+    disk->lz = (lz_state_t*)kmalloc(sizeof(lz_state_t));
+    disk->packed = (unsigned char*)kmalloc(RAMDISK_RAW_LIMIT);
+    if (block_count == 0 || hot_data == NULL || disk->blocks == NULL || disk->lengths == NULL ||
+        disk->lz == NULL || disk->packed == NULL) {
+        ramdisk_free_compressed(disk, hot_data);
         return -1;
     }
+    memset(disk->blocks, 0, block_count * sizeof(unsigned char*));
+    memset(disk->lengths, 0, block_count * sizeof(unsigned short));
+    memset(&disk->stats, 0, sizeof(disk->stats));
 
-    if (start_block + count > g_ramdisk.block_count) {
-        return -1;  // Blocks out of range
+    for (int i = 0; i < RAMDISK_HOT_BLOCKS; i++) {
+        disk->hot[i].valid = 0;
+        disk->hot[i].dirty = 0;
+        disk->hot[i].last_use = 0;
+        disk->hot[i].data = hot_data + i * BLOCK_SIZE;
     }
+    disk->hot_tick = 0;
 
-    // Write each block
-    for (unsigned int i = 0; i < count; i++) {
-        if (ramdisk_write_block(start_block + i, buffer + (i * BLOCK_SIZE)) != 0) {
-            return -1;
+    disk->data = NULL;
+    disk->written = NULL;
+    disk->size = block_count * BLOCK_SIZE;
+    disk->block_count = block_count;
+    disk->compressed = 1;
+
+    disk->device = block_register(&ramdisk_lz_driver, disk, block_count);
+    if (disk->device < 0) {
+        ramdisk_free_compressed(disk, hot_data);
+        return -1;
+    }
+
+    disk->initialized = 1;
+    return disk->device;
+}
+
+/**
+ * Get compression statistics of a RAM disk
+ *
+ * @param device: Block device number
+ * @param stats: Filled in on success
+ * @return: 0 on success, -1 if the device is not a compressed RAM disk
+ */
+int ramdisk_get_compress_stats(int device, ramdisk_compress_stats_t* stats)
+{
+    for (int i = 0; i < RAMDISK_MAX_DISKS; i++) {
+        ramdisk_t* disk = &g_ramdisks[i];
+        if (disk->initialized && disk->compressed && disk->device == device) {
+            if (stats != NULL) {
+                *stats = disk->stats;
+            }
+            return 0;
         }
     }
+    return -1;
+}
 
-    return 0;
+// ----------------------------------------------------------------------------
+// Disk creation
+// ----------------------------------------------------------------------------
+
+/**
+ * Set up a RAM disk over a region of memory and register it
+ * The disk is not zeroed here; unwritten blocks read as zeros instead.
+ *
+ * @param disk: Disk structure to fill
+ * @param data: Backing memory
+ * @param size: Size of the backing memory in bytes
+ * @return: Block device number, or -1 on error
+ */
+static int ramdisk_attach(ramdisk_t* disk, unsigned char* data, unsigned int size)
+{
+    disk->data = data;
+    disk->size = size;
+    disk->block_count = size / BLOCK_SIZE;
+
+    // Fresh disk: no block written yet, so everything reads as zeros.
+    // Without room for the bitmap, zero the whole disk up front instead.
+    unsigned int bitmap_size = (disk->block_count + 31) / 32 * sizeof(unsigned int);
+    disk->written = (unsigned int*)kmalloc(bitmap_size);
+    if (disk->written != NULL) {
+        memset(disk->written, 0, bitmap_size);
+    } else {
+        memset(disk->data, 0, size);
+    }
+
+    disk->device = block_register(&ramdisk_driver, disk, disk->block_count);
+    if (disk->device < 0) {
+        kfree(disk->written);
+        disk->written = NULL;
+        return -1;
+    }
+
+    disk->initialized = 1;
+    return disk->device;
+}
+
+/**
+ * Initialize RAM disk
+ * Carves a contiguous physical region for the boot disk, halving the size
+ * until it fits, and falls back to a small heap buffer if there is none
+ *
+ * @return: 0 on success, -1 on failure
+ */
+int ramdisk_init(void)
+{
+    ramdisk_t* disk = &g_ramdisks[0];
+    if (disk->initialized) {
+        return 0;  // Already initialized
+    }
+
+    // Size in pages: requested, or a share of free physical memory
+    unsigned int free_pages;
+    pmm_get_info(NULL, &free_pages);
+    unsigned int pages = free_pages / RAMDISK_RAM_SHARE;
+    if (requested_size != 0) {
+        pages = requested_size / PAGE_SIZE;
+    }
+
+    // Compressed disks draw block storage from the heap as they fill
+    if (compression_enabled) {
+        if (requested_size == 0) {
+            unsigned int limit = 0xFFFFFFFFu / PAGE_SIZE / RAMDISK_COMPRESS_FACTOR;
+            pages = ((pages < limit) ? pages : limit) * RAMDISK_COMPRESS_FACTOR;
+        }
+        if (ramdisk_attach_compressed(disk, pages * PAGE_SIZE) >= 0) {
+            return 0;
+        }
+        // Not enough memory for the tables: fall back to a plain disk
+    }
+
+    unsigned int size = 0;
+    unsigned char* data = NULL;
+    while (pages >= RAMDISK_MIN_SIZE / PAGE_SIZE) {
+        data = (unsigned char*)pmm_alloc_contiguous(pages);
+        if (data != NULL) {
+            size = pages * PAGE_SIZE;
+            break;
+        }
+        pages /= 2;
+    }
+
+    // No physical region - use a small disk from the heap
+    if (data == NULL) {
+        size = RAMDISK_FALLBACK_SIZE;
+        data = (unsigned char*)kmalloc_pages(size / PAGE_SIZE);
+        if (data == NULL) {
+            return -1;  // Out of memory
+        }
+    }
+
+    return (ramdisk_attach(disk, data, size) >= 0) ? 0 : -1;
+}
+
+/**
+ * Create an additional RAM disk
+ *
+ * @param size: Disk size in bytes (rounded down to whole pages)
+ * @return: Block device number, or -1 on error
+ */
+int ramdisk_create(unsigned int size)
+{
+    unsigned int pages = size / PAGE_SIZE;
+    if (pages == 0) {
+        return -1;
+    }
+
+    // Slot 0 is reserved for the boot disk
+    ramdisk_t* disk = NULL;
+    for (int i = 1; i < RAMDISK_MAX_DISKS; i++) {
+        if (!g_ramdisks[i].initialized) {
+            disk = &g_ramdisks[i];
+            break;
+        }
+    }
+    if (disk == NULL || block_device_count() >= BLOCK_MAX_DEVICES) {
+        return -1;  // Check before carving memory that could not be given back
+    }
+
+    if (compression_enabled) {
+        return ramdisk_attach_compressed(disk, pages * PAGE_SIZE);
+    }
+
+    unsigned char* data = (unsigned char*)pmm_alloc_contiguous(pages);
+    if (data == NULL) {
+        data = (unsigned char*)kmalloc_pages(pages);
+        if (data == NULL) {
+            return -1;  // Out of memory
+        }
+    }
+
+    return ramdisk_attach(disk, data, pages * PAGE_SIZE);
 }
 
 /**
  * Get RAM disk information
- * 
+ *
  * @param size: Pointer to store total size (can be NULL)
  * @param blocks: Pointer to store block count (can be NULL)
  */
 void ramdisk_get_info(unsigned int* size, unsigned int* blocks)
 {
     if (size != NULL) {
-        *size = g_ramdisk.size;
+        *size = g_ramdisks[0].size;
     }
     if (blocks != NULL) {
-        *blocks = g_ramdisk.block_count;
+        *blocks = g_ramdisks[0].block_count;
     }
 }
-
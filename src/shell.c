@@ -3,6 +3,11 @@
 #include "source.h"
 #include "output.h"
 #include "malloc.h"
+#include "pmm.h"
+#include "arena.h"
+#include "block.h"
+#include "ramdisk.h"
+#include "buffer.h"
 
 shell_state_t shell_state;  // Current shell state
 
@@ -14,7 +19,11 @@ void shell_init()
     strcpy(shell_state.current_directory.path, "/");
     shell_state.current_directory.entry_count = 0;
 
-    filesystem_init();  // Initialize file system
+    // Initialize file system
+    if (filesystem_init() != 0) {
+        print_formatted_string("No file system on disk (boot with format=1 to create one)", RED);
+        print_newline();
+    }
 
     // Welcome message
     print_formatted_string("Karion-OS Shell v1.0", WHITE_COLOR);
@@ -54,8 +63,8 @@ int parse_command(char* input, char* command, char** args)
     return 0;
 }
 
-// Execute a command
-int execute_command(char* command, char** args)
+// Run the handler for a command
+static int dispatch_command(char* command, char** args)
 {
     if (strcmp(command, "help") == 0) return cmd_help(args);
     if (strcmp(command, "clear") == 0) return cmd_clear(args);
@@ -67,6 +76,9 @@ int execute_command(char* command, char** args)
     if (strcmp(command, "touch") == 0) return cmd_touch(args);
     if (strcmp(command, "del") == 0) return cmd_del(args);
     if (strcmp(command, "cat") == 0) return cmd_cat(args);
+    if (strcmp(command, "meminfo") == 0) return cmd_meminfo(args);
+    if (strcmp(command, "iostat") == 0) return cmd_iostat(args);
+    if (strcmp(command, "sync") == 0) return cmd_sync(args);
     if (strcmp(command, "") == 0) return 0;
 
     print_string("\nCommand not found: ", RED);
@@ -75,6 +87,29 @@ int execute_command(char* command, char** args)
     return -1;
 }
 
+// Check whether a command can change the file system
+static int command_writes_files(char* command)
+{
+    return strcmp(command, "mkdir") == 0 || strcmp(command, "touch") == 0 ||
+           strcmp(command, "del") == 0 || strcmp(command, "echo") == 0;
+}
+
+// Execute a command
+// Per-command temporaries in the scratch arena are released afterwards.
+// Commands that change files write the cached blocks back when they
+// finish, so the changes are on the disk before the next prompt.
+int execute_command(char* command, char** args)
+{
+    int result = dispatch_command(command, args);
+    if (command_writes_files(command) && bflush() != 0) {
+        print_newline();
+        print_formatted_string("Error writing cached blocks to disk", RED);
+        result = -1;
+    }
+    arena_reset(&scratch_arena);
+    return result;
+}
+
 // Built-in commands
 int cmd_help(char** args)
 {
@@ -101,6 +136,12 @@ int cmd_help(char** args)
     print_newline();
     print_formatted_string("  cat      - Read and display file contents", WHITE_COLOR);
     print_newline();
+    print_formatted_string("  meminfo  - Show memory usage and fragmentation", WHITE_COLOR);
+    print_newline();
+    print_formatted_string("  iostat   - Show block I/O and buffer cache statistics (iostat reset clears them)", WHITE_COLOR);
+    print_newline();
+    print_formatted_string("  sync     - Write cached changes to disk", WHITE_COLOR);
+    print_newline();
     print_formatted_string("  echo >   - Write text to file (e.g., echo hello > file.txt)", WHITE_COLOR);
     print_newline();
     return 0;
@@ -337,8 +378,306 @@ int cmd_cat(char** args)
     print_formatted_string(content, WHITE_COLOR);
     print_newline();
 
-    // Free the buffer (allocated by fs_read_file)
-    kfree(content);
+    return 0;
+}
+
+// Print one "label value unit" statistics line
+static void print_stat(char* label, unsigned int value, char* unit)
+{
+    char num[12];
+    print_formatted_string(label, WHITE_COLOR);
+    print_formatted_string(utoa(value, num, 10), GREEN);
+    print_formatted_string(unit, WHITE_COLOR);
+    print_newline();
+}
+
+int cmd_meminfo(char** args)
+{
+    (void)args;
+    heap_stats_t stats;
+    heap_get_stats(&stats);
+
+    unsigned int total_pages, free_pages;
+    pmm_get_info(&total_pages, &free_pages);
+
+    print_newline();
+    print_stat("Heap size:     ", stats.heap_size, " bytes");
+    print_stat("In use:        ", stats.in_use, " bytes");
+    print_stat("Peak in use:   ", stats.peak, " bytes");
+    print_stat("Free:          ", stats.free_bytes, " bytes");
+    print_stat("Free blocks:   ", stats.free_blocks, "");
+    print_stat("Largest free:  ", stats.largest_free, " bytes");
+    print_stat("Page runs:     ", stats.page_bytes, " bytes");
+    print_stat("Slab pages:    ", stats.slab_pages, "");
+    print_stat("Free pages:    ", free_pages, "");
+    print_stat("Total pages:   ", total_pages, "");
+
+    // One line per size class: "  <size>: <active> active, <allocs> allocs"
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        char line[MAX_COMMAND_LENGTH], num[12];
+        strcpy(line, "  ");
+        strcat(line, utoa(stats.class_size[i], num, 10));
+        strcat(line, ": ");
+        strcat(line, utoa(stats.class_active[i], num, 10));
+        strcat(line, " active, ");
+        strcat(line, utoa(stats.class_allocs[i], num, 10));
+        strcat(line, " allocs");
+        print_formatted_string(line, WHITE_COLOR);
+        print_newline();
+    }
+
+    return 0;
+}
+
+// Append a cycle count, shortened with a K/M suffix when it divides evenly
+static void append_cycles(char* line, unsigned int cycles)
+{
+    char num[12];
+    char* suffix = "";
+    if (cycles >= (1u << 20) && (cycles & ((1u << 20) - 1)) == 0) {
+        cycles >>= 20;
+        suffix = "M";
+    } else if (cycles >= (1u << 10) && (cycles & ((1u << 10) - 1)) == 0) {
+        cycles >>= 10;
+        suffix = "K";
+    }
+    strcat(line, utoa(cycles, num, 10));
+    strcat(line, suffix);
+}
 
+// Append total / count for a 64-bit cycle total
+// No 64-bit division in the kernel: the average is in K cycles once the total is large
+static void append_average(char* line, unsigned long long total, unsigned int count)
+{
+    char num[12];
+    if ((total >> 32) == 0) {
+        strcat(line, utoa((unsigned int)total / count, num, 10));
+    } else {
+        strcat(line, utoa((unsigned int)(total >> 10) / count, num, 10));
+        strcat(line, "K");
+    }
+}
+
+// Print the compression line of a compressed RAM disk
+static void print_compress_stats(ramdisk_compress_stats_t* stats)
+{
+    char line[MAX_COMMAND_LENGTH], num[12];
+
+    // "  Compressed: <blocks> blocks in <bytes> bytes (ratio <x.yy>), <raw> raw"
+    strcpy(line, "  Compressed: ");
+    strcat(line, utoa(stats->stored_blocks, num, 10));
+    strcat(line, " blocks in ");
+    strcat(line, utoa(stats->stored_bytes, num, 10));
+    strcat(line, " bytes");
+    if (stats->stored_bytes > 0) {
+        unsigned int logical = stats->stored_blocks * BLOCK_SIZE;
+        unsigned int whole = logical / stats->stored_bytes;
+
+        // Fraction = remainder * 100 / stored. No 64-bit division in the
+        // kernel, so both are halved until the product fits in 32 bits
+        // (exact below 42 MB stored, off by at most one hundredth above)
+        unsigned int remainder = logical % stats->stored_bytes;
+        unsigned int divisor = stats->stored_bytes;
+        while (divisor > 0xFFFFFFFFu / 100) {
+            remainder >>= 1;
+            divisor >>= 1;
+        }
+        unsigned int hundredths = remainder * 100 / divisor;
+        strcat(line, " (ratio ");
+        strcat(line, utoa(whole, num, 10));
+        strcat(line, hundredths < 10 ? ".0" : ".");
+        strcat(line, utoa(hundredths, num, 10));
+        strcat(line, ")");
+    }
+    strcat(line, ", ");
+    strcat(line, utoa(stats->raw_blocks, num, 10));
+    strcat(line, " raw");
+    print_formatted_string(line, WHITE_COLOR);
+    print_newline();
+
+    // "  Codec: <n> packs avg <c>, <n> unpacks avg <c> cycles, hot <hits>/<misses>"
+    strcpy(line, "  Codec: ");
+    strcat(line, utoa(stats->compressions, num, 10));
+    strcat(line, " packs");
+    if (stats->compressions > 0) {
+        strcat(line, " avg ");
+        append_average(line, stats->compress_cycles, stats->compressions);
+    }
+    strcat(line, ", ");
+    strcat(line, utoa(stats->decompressions, num, 10));
+    strcat(line, " unpacks");
+    if (stats->decompressions > 0) {
+        strcat(line, " avg ");
+        append_average(line, stats->decompress_cycles, stats->decompressions);
+    }
+    strcat(line, " cycles, hot ");
+    strcat(line, utoa(stats->hot_hits, num, 10));
+    strcat(line, "/");
+    strcat(line, utoa(stats->hot_misses, num, 10));
+    print_formatted_string(line, WHITE_COLOR);
+    print_newline();
+}
+
+// Print the counters and latency histogram for one direction
+static void print_io_stats(char* label, block_io_stats_t* stats)
+{
+    char line[MAX_COMMAND_LENGTH], num[12];
+
+    // "  Reads:  <ops> ops, <blocks> blocks, <errors> errors, avg <n> cycles"
+    strcpy(line, label);
+    strcat(line, utoa(stats->ops, num, 10));
+    strcat(line, " ops, ");
+    strcat(line, utoa(stats->blocks, num, 10));
+    strcat(line, " blocks, ");
+    strcat(line, utoa(stats->errors, num, 10));
+    strcat(line, " errors");
+    if (stats->ops > 0) {
+        strcat(line, ", avg ");
+        append_average(line, stats->cycles, stats->ops);
+        strcat(line, ", max ");
+        append_cycles(line, stats->max_cycles);
+        strcat(line, " cycles");
+    }
+    print_formatted_string(line, WHITE_COLOR);
+    print_newline();
+
+    if (stats->ops == 0) {
+        return;
+    }
+
+    // Non-empty buckets as "<bound:count", the last one open-ended
+    strcpy(line, "    ");
+    for (int b = 0; b < BLOCK_HIST_BUCKETS; b++) {
+        if (stats->histogram[b] == 0) {
+            continue;
+        }
+        if (strlen(line) > 64) {  // Wrap before the 80-column screen edge
+            print_formatted_string(line, GREEN);
+            print_newline();
+            strcpy(line, "    ");
+        }
+        if (b < BLOCK_HIST_BUCKETS - 1) {
+            strcat(line, "<");
+            append_cycles(line, 1u << (b + BLOCK_HIST_SHIFT + 1));
+        } else {
+            strcat(line, ">=");
+            append_cycles(line, 1u << (b + BLOCK_HIST_SHIFT));
+        }
+        strcat(line, ":");
+        strcat(line, utoa(stats->histogram[b], num, 10));
+        strcat(line, " ");
+    }
+    print_formatted_string(line, GREEN);
+    print_newline();
+}
+
+// Print buffer cache size and hit rate
+static void print_buffer_stats(void)
+{
+    buffer_stats_t stats;
+    buffer_get_stats(&stats);
+    char line[MAX_COMMAND_LENGTH], num[12];
+
+    // "Buffer cache: <n> buffers (<k> KB), <n> hash buckets"
+    strcpy(line, "Buffer cache: ");
+    strcat(line, utoa(stats.buffers, num, 10));
+    strcat(line, " buffers (");
+    strcat(line, utoa(stats.buffers * BLOCK_SIZE / 1024, num, 10));
+    strcat(line, " KB), ");
+    strcat(line, utoa(stats.hash_buckets, num, 10));
+    strcat(line, " hash buckets");
+    print_formatted_string(line, YELLOW);
+    print_newline();
+
+    // "  Hits: <n> (<p>%), misses: <n>, evictions: <n>, writebacks: <n>, readahead: <n>"
+    strcpy(line, "  Hits: ");
+    strcat(line, utoa(stats.hits, num, 10));
+    if (stats.hits + stats.misses > 0) {
+        // Scale down so the percentage cannot overflow
+        unsigned int hits = stats.hits, misses = stats.misses;
+        while (hits > 0xFFFFFF || misses > 0xFFFFFF) {
+            hits >>= 1;
+            misses >>= 1;
+        }
+        strcat(line, " (");
+        strcat(line, utoa(hits * 100 / (hits + misses), num, 10));
+        strcat(line, "%)");
+    }
+    strcat(line, ", misses: ");
+    strcat(line, utoa(stats.misses, num, 10));
+    strcat(line, ", evictions: ");
+    strcat(line, utoa(stats.evictions, num, 10));
+    strcat(line, ", writebacks: ");
+    strcat(line, utoa(stats.writebacks, num, 10));
+    strcat(line, ", readahead: ");
+    strcat(line, utoa(stats.readahead, num, 10));
+    print_formatted_string(line, WHITE_COLOR);
+    print_newline();
+}
+
+int cmd_iostat(char** args)
+{
+    if (args[0] && strcmp(args[0], "reset") == 0) {
+        block_reset_stats();
+        buffer_reset_stats();
+        print_newline();
+        print_formatted_string("I/O statistics cleared", GREEN);
+        print_newline();
+        return 0;
+    }
+
+    print_newline();
+    for (int id = 0; id < block_device_count(); id++) {
+        block_device_t* dev = block_get_device(id);
+        char line[MAX_COMMAND_LENGTH], num[12];
+
+        // "Device <id>: <driver>, <blocks> blocks"
+        strcpy(line, "Device ");
+        strcat(line, utoa(id, num, 10));
+        strcat(line, ": ");
+        strcat(line, (char*)dev->driver->name);
+        strcat(line, ", ");
+        strcat(line, utoa(dev->total_blocks, num, 10));
+        strcat(line, " blocks");
+        print_formatted_string(line, YELLOW);
+        print_newline();
+
+        print_io_stats("  Reads:  ", &dev->stats.read);
+        print_io_stats("  Writes: ", &dev->stats.write);
+
+        // "  Merges: <n>, maps: <n>, flushes: <n>, discards: <n>"
+        strcpy(line, "  Merges: ");
+        strcat(line, utoa(dev->stats.merges, num, 10));
+        strcat(line, ", maps: ");
+        strcat(line, utoa(dev->stats.maps, num, 10));
+        strcat(line, ", flushes: ");
+        strcat(line, utoa(dev->stats.flushes, num, 10));
+        strcat(line, ", discards: ");
+        strcat(line, utoa(dev->stats.discards, num, 10));
+        print_formatted_string(line, WHITE_COLOR);
+        print_newline();
+
+        ramdisk_compress_stats_t compress;
+        if (ramdisk_get_compress_stats(id, &compress) == 0) {
+            print_compress_stats(&compress);
+        }
+    }
+    print_buffer_stats();
+
+    return 0;
+}
+
+int cmd_sync(char** args)
+{
+    (void)args;
+    print_newline();
+    if (bflush() != 0) {
+        print_formatted_string("Error writing cached blocks to disk", RED);
+        print_newline();
+        return -1;
+    }
+
+    print_formatted_string("Cached blocks written to disk", GREEN);
+    print_newline();
     return 0;
 }
@@ -63,9 +63,7 @@ void backspace_char(void)
 void scroll_screen_up(void)
 {
     // Move lines up by one
-    for (int i = 0; i < 24 * 80; i++) {
-        terminal_buffer[i] = terminal_buffer[i + 80];
-    }
+    memmove(terminal_buffer, terminal_buffer + 80, 24 * 80 * sizeof(unsigned short));
 
     // Clear last line
     for (int i = 24 * 80; i < 25 * 80; i++) {
@@ -73,21 +71,169 @@ void scroll_screen_up(void)
     }
 }
 
+// Word type for word-at-a-time loops (may alias any object)
+typedef unsigned int __attribute__((may_alias)) word_t;
+
+#define WORD_SIZE     sizeof(word_t)
+#define WORD_ONES     0x01010101u
+#define WORD_HIGHS    0x80808080u
+#define MEM_MIN_BYTES 16  // Shorter operations (in bytes) skip the alignment head
+
+// Non-zero if any byte of w is zero
+#define HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+
+void* memcpy(void* dest, const void* src, unsigned int n)
+{
+    unsigned char* d = (unsigned char*)dest;
+    const unsigned char* s = (const unsigned char*)src;
+
+    if (n >= MEM_MIN_BYTES) {
+        // Head: byte copies until the destination is word aligned
+        while ((unsigned long)d & (WORD_SIZE - 1)) { *d++ = *s++; n--; }
+
+#if defined(__i386__) || defined(__x86_64__)
+        unsigned long words = n / WORD_SIZE;
+        __asm__ volatile ("rep movsl" : "+D" (d), "+S" (s), "+c" (words) : : "memory");
+#else
+        for (unsigned int words = n / WORD_SIZE; words > 0; words--) {
+            *(word_t*)d = *(const word_t*)s;
+            d += WORD_SIZE;
+            s += WORD_SIZE;
+        }
+#endif
+        n &= WORD_SIZE - 1;
+    }
+
+    // Tail
+    while (n--) *d++ = *s++;
+    return dest;
+}
+
+void* memmove(void* dest, const void* src, unsigned int n)
+{
+    unsigned char* d = (unsigned char*)dest;
+    const unsigned char* s = (const unsigned char*)src;
+
+    // Forward copy is safe unless dest starts inside src
+    if (d <= s || d >= s + n) {
+        return memcpy(dest, src, n);
+    }
+
+    // Copy backwards from the end
+    d += n;
+    s += n;
+    if (n >= MEM_MIN_BYTES) {
+        while ((unsigned long)d & (WORD_SIZE - 1)) { *--d = *--s; n--; }
+
+#if defined(__i386__) || defined(__x86_64__)
+        unsigned long words = n / WORD_SIZE;
+        d -= WORD_SIZE;
+        s -= WORD_SIZE;
+        __asm__ volatile ("std\n\trep movsl\n\tcld" : "+D" (d), "+S" (s), "+c" (words) : : "memory");
+        d += WORD_SIZE;
+        s += WORD_SIZE;
+#else
+        for (unsigned int words = n / WORD_SIZE; words > 0; words--) {
+            d -= WORD_SIZE;
+            s -= WORD_SIZE;
+            *(word_t*)d = *(const word_t*)s;
+        }
+#endif
+        n &= WORD_SIZE - 1;
+    }
+
+    while (n--) *--d = *--s;
+    return dest;
+}
+
+void* memset(void* dest, int c, unsigned int n)
+{
+    unsigned char* d = (unsigned char*)dest;
+    unsigned char byte = (unsigned char)c;
+
+    if (n >= MEM_MIN_BYTES) {
+        while ((unsigned long)d & (WORD_SIZE - 1)) { *d++ = byte; n--; }
+
+        word_t pattern = byte * WORD_ONES;
+#if defined(__i386__) || defined(__x86_64__)
+        unsigned long words = n / WORD_SIZE;
+        __asm__ volatile ("rep stosl" : "+D" (d), "+c" (words) : "a" (pattern) : "memory");
+#else
+        for (unsigned int words = n / WORD_SIZE; words > 0; words--) {
+            *(word_t*)d = pattern;
+            d += WORD_SIZE;
+        }
+#endif
+        n &= WORD_SIZE - 1;
+    }
+
+    while (n--) *d++ = byte;
+    return dest;
+}
+
+int memcmp(const void* s1, const void* s2, unsigned int n)
+{
+    const unsigned char* a = (const unsigned char*)s1;
+    const unsigned char* b = (const unsigned char*)s2;
+
+    // Skip equal words (x86 allows unaligned loads), then find the differing byte
+    while (n >= WORD_SIZE && *(const word_t*)a == *(const word_t*)b) {
+        a += WORD_SIZE;
+        b += WORD_SIZE;
+        n -= WORD_SIZE;
+    }
+
+    while (n--) {
+        if (*a != *b) return *a - *b;
+        a++;
+        b++;
+    }
+    return 0;
+}
+
 int strlen(const char* str)
 {
-    int len = 0;
-    while (str[len] != '\0') len++;
-    return len;
+    const char* p = str;
+
+    // Bytes until p is word aligned (aligned loads never cross a page)
+    while ((unsigned long)p & (WORD_SIZE - 1)) {
+        if (*p == '\0') return p - str;
+        p++;
+    }
+
+    const word_t* w = (const word_t*)p;
+    while (!HAS_ZERO(*w)) w++;
+
+    p = (const char*)w;
+    while (*p != '\0') p++;
+    return p - str;
 }
 
 int strcmp(const char* s1, const char* s2)
 {
-    int i = 0;
-    while (s1[i] != '\0' && s2[i] != '\0') {
-        if (s1[i] != s2[i]) return s1[i] - s2[i];
-        i++;
+    // Compare a word at a time while both strings share an alignment
+    if ((((unsigned long)s1 ^ (unsigned long)s2) & (WORD_SIZE - 1)) == 0) {
+        while ((unsigned long)s1 & (WORD_SIZE - 1)) {
+            if (*s1 == '\0' || *s1 != *s2) return *s1 - *s2;
+            s1++;
+            s2++;
+        }
+
+        const word_t* w1 = (const word_t*)s1;
+        const word_t* w2 = (const word_t*)s2;
+        while (*w1 == *w2 && !HAS_ZERO(*w1)) {
+            w1++;
+            w2++;
+        }
+        s1 = (const char*)w1;
+        s2 = (const char*)w2;
+    }
+
+    while (*s1 != '\0' && *s1 == *s2) {
+        s1++;
+        s2++;
     }
-    return s1[i] - s2[i];
+    return *s1 - *s2;
 }
 
 char* strcpy(char* dest, const char* src)
@@ -116,13 +262,25 @@ char* strncpy(char* dest, const char* src, int n)
 
 char* strchr(const char* str, int c)
 {
-    int i = 0;
-    while (str[i] != '\0') {
-        if (str[i] == c) return (char*)&str[i];
-        i++;
+    char ch = (char)c;
+
+    while ((unsigned long)str & (WORD_SIZE - 1)) {
+        if (*str == ch) return (char*)str;
+        if (*str == '\0') return NULL;
+        str++;
     }
-    if (c == '\0') return (char*)&str[i];  // NULL terminator
-    return NULL;
+
+    // Stop at the first word holding either the terminator or c
+    word_t pattern = (unsigned char)ch * WORD_ONES;
+    const word_t* w = (const word_t*)str;
+    while (!HAS_ZERO(*w) && !HAS_ZERO(*w ^ pattern)) w++;
+
+    str = (const char*)w;
+    while (*str != ch) {
+        if (*str == '\0') return NULL;
+        str++;
+    }
+    return (char*)str;
 }
 
 char* strrchr(const char* str, int c)
@@ -137,6 +295,22 @@ char* strrchr(const char* str, int c)
     return last;
 }
 
+char* utoa(unsigned int value, char* str, int base)
+{
+    char digits[32];
+    int n = 0;
+    do {
+        int d = value % base;
+        digits[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+        value /= base;
+    } while (value != 0);
+
+    int i = 0;
+    while (n > 0) str[i++] = digits[--n];
+    str[i] = '\0';
+    return str;
+}
+
 void print_newline(void)
 {
     // Advance to next line
@@ -0,0 +1,370 @@
+#include "virtio.h"
+#include "io.h"
+#include "malloc.h"
+#include "source.h"
+
+static virtio_blk_t g_virtio_disks[VIRTIO_BLK_MAX_DISKS];
+static int g_virtio_disk_count = 0;
+
+/**
+ * Keep the compiler from moving ring accesses across this point
+ * x86 does not reorder stores with stores or loads with loads, so a
+ * compiler barrier is enough to publish descriptors before the index
+ */
+static inline void virtio_barrier(void)
+{
+    __asm__ volatile ("" : : : "memory");
+}
+
+/**
+ * Notify the device of the queued batch and wait for all of it
+ *
+ * @param blk: Disk
+ * @return: 0 if every request succeeded, -1 on error or timeout
+ */
+static int virtio_blk_kick(virtio_blk_t* blk)
+{
+    int result = 0;
+
+    if (blk->next_desc == 0) {
+        return 0;  // Nothing queued
+    }
+
+    virtio_barrier();
+    outw(blk->io + VIRTIO_REG_QUEUE_NOTIFY, 0);
+
+    volatile unsigned short* used_index = &blk->used->index;
+    unsigned int polls = 0;
+    while (blk->used_index != blk->avail_index) {
+        if (*used_index == blk->used_index) {
+            if (++polls == VIRTIO_TIMEOUT) {
+                return -1;  // Device stopped answering: leave the queue as is
+            }
+            continue;
+        }
+        virtio_barrier();
+
+        virtq_used_elem_t* elem = &blk->used->ring[blk->used_index % blk->queue_size];
+        if (blk->reqs[elem->id].status != VIRTIO_BLK_S_OK) {
+            result = -1;
+        }
+        blk->used_index++;
+    }
+
+    blk->next_desc = 0;
+    return result;
+}
+
+/**
+ * Fill in one descriptor
+ *
+ * @param blk: Disk
+ * @param index: Descriptor number
+ * @param address: Buffer
+ * @param length: Buffer size in bytes
+ * @param flags: VIRTQ_DESC_F_* flags
+ */
+static void virtio_blk_desc(virtio_blk_t* blk, unsigned int index, void* address, unsigned int length, unsigned short flags)
+{
+    virtq_desc_t* desc = &blk->desc[index];
+    desc->address = (unsigned long)address;
+    desc->length = length;
+    desc->flags = flags;
+    desc->next = (flags & VIRTQ_DESC_F_NEXT) ? index + 1 : 0;
+}
+
+/**
+ * Transfer consecutive sectors scattered over several buffers
+ * The range becomes as few requests as the device limits allow; all of
+ * them are queued before a single notify. Only when the queue fills up
+ * is the batch kicked early and the rest queued behind it. A failed
+ * request fails the whole call.
+ *
+ * @param blk: Disk
+ * @param type: VIRTIO_BLK_T_IN, VIRTIO_BLK_T_OUT or VIRTIO_BLK_T_FLUSH
+ * @param sector: First sector
+ * @param segments: Data buffers in order (NULL for a flush)
+ * @param nsegments: Number of segments
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_submit(virtio_blk_t* blk, unsigned int type, unsigned int sector,
+                             block_segment_t* segments, unsigned int nsegments)
+{
+    unsigned short data_flags = VIRTQ_DESC_F_NEXT | ((type == VIRTIO_BLK_T_IN) ? VIRTQ_DESC_F_WRITE : 0);
+    unsigned int seg = 0;
+    unsigned int offset = 0;  // Bytes of segments[seg] already queued
+
+    do {
+        // A request needs a header, at least one data descriptor and a status
+        if (blk->queue_size - blk->next_desc < 3) {
+            if (virtio_blk_kick(blk) != 0) {
+                return -1;
+            }
+        }
+
+        unsigned int head = blk->next_desc++;
+        virtio_blk_req_t* req = &blk->reqs[head];
+        req->type = type;
+        req->reserved = 0;
+        req->sector = sector;
+        req->status = 0xFF;
+        virtio_blk_desc(blk, head, req, 16, VIRTQ_DESC_F_NEXT);
+
+        // Data descriptors, keeping one back for the status byte
+        unsigned int data = 0;
+        while (seg < nsegments && data < blk->seg_max && blk->next_desc < blk->queue_size - 1) {
+            unsigned int length = segments[seg].count * BLOCK_SIZE - offset;
+            if (length == 0) {
+                seg++;
+                offset = 0;
+                continue;
+            }
+            if (length > blk->size_max) {
+                length = blk->size_max;
+            }
+
+            virtio_blk_desc(blk, blk->next_desc++, segments[seg].buffer + offset, length, data_flags);
+            sector += length / BLOCK_SIZE;
+            offset += length;
+            data++;
+        }
+
+        virtio_blk_desc(blk, blk->next_desc++, &req->status, 1, VIRTQ_DESC_F_WRITE);
+
+        blk->avail->ring[blk->avail_index % blk->queue_size] = head;
+        blk->avail_index++;
+        virtio_barrier();
+        blk->avail->index = blk->avail_index;
+
+        // Skip empty trailing segments so they do not start a request
+        while (seg < nsegments && segments[seg].count * BLOCK_SIZE == offset) {
+            seg++;
+            offset = 0;
+        }
+    } while (seg < nsegments);
+
+    return virtio_blk_kick(blk);
+}
+
+/**
+ * Read blocks from a virtio disk
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param count: Number of blocks to read
+ * @param buffer: Buffer to store data (must be count * BLOCK_SIZE bytes)
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_read(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    block_segment_t segment = { buffer, count };
+    return virtio_blk_submit((virtio_blk_t*)dev->driver_data, VIRTIO_BLK_T_IN, start_block, &segment, 1);
+}
+
+/**
+ * Write blocks to a virtio disk
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param count: Number of blocks to write
+ * @param buffer: Data to write (must be count * BLOCK_SIZE bytes)
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_write(block_device_t* dev, unsigned int start_block, unsigned int count, unsigned char* buffer)
+{
+    block_segment_t segment = { buffer, count };
+    return virtio_blk_submit((virtio_blk_t*)dev->driver_data, VIRTIO_BLK_T_OUT, start_block, &segment, 1);
+}
+
+/**
+ * Read consecutive blocks into several buffers
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param segments: Destination buffers in order
+ * @param nsegments: Number of segments
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_readv(block_device_t* dev, unsigned int start_block, block_segment_t* segments, unsigned int nsegments)
+{
+    return virtio_blk_submit((virtio_blk_t*)dev->driver_data, VIRTIO_BLK_T_IN, start_block, segments, nsegments);
+}
+
+/**
+ * Write consecutive blocks from several buffers
+ *
+ * @param dev: Block device
+ * @param start_block: Starting block number
+ * @param segments: Source buffers in order
+ * @param nsegments: Number of segments
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_writev(block_device_t* dev, unsigned int start_block, block_segment_t* segments, unsigned int nsegments)
+{
+    return virtio_blk_submit((virtio_blk_t*)dev->driver_data, VIRTIO_BLK_T_OUT, start_block, segments, nsegments);
+}
+
+/**
+ * Flush the device's write cache
+ * Disks that did not offer VIRTIO_BLK_F_FLUSH write through
+ *
+ * @param dev: Block device
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_flush(block_device_t* dev)
+{
+    virtio_blk_t* blk = (virtio_blk_t*)dev->driver_data;
+
+    if (!(blk->features & VIRTIO_BLK_F_FLUSH)) {
+        return 0;
+    }
+    return virtio_blk_submit(blk, VIRTIO_BLK_T_FLUSH, 0, NULL, 0);
+}
+
+static const block_driver_t virtio_blk_driver = {
+    .name = "virtio-blk",
+    .persistent = 1,
+    .read = virtio_blk_read,
+    .write = virtio_blk_write,
+    .readv = virtio_blk_readv,
+    .writev = virtio_blk_writev,
+    .flush = virtio_blk_flush,
+    .discard = NULL,
+    .map = NULL,
+    .unmap = NULL,
+};
+
+/**
+ * Allocate and register the request virtqueue (queue 0)
+ * Legacy layout: descriptors, then the available ring, then the used
+ * ring on the next VIRTQ_ALIGN boundary, all physically contiguous
+ *
+ * @param blk: Disk
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_setup_queue(virtio_blk_t* blk)
+{
+    outw(blk->io + VIRTIO_REG_QUEUE_SELECT, 0);
+    unsigned int size = inw(blk->io + VIRTIO_REG_QUEUE_SIZE);
+    if (size < 3) {
+        return -1;  // Queue missing (or too small for one request)
+    }
+
+    unsigned int ring_bytes = size * sizeof(virtq_desc_t) + sizeof(virtq_avail_t) + (size + 1) * 2;
+    unsigned int used_offset = (ring_bytes + VIRTQ_ALIGN - 1) & ~(VIRTQ_ALIGN - 1);
+    unsigned int used_bytes = sizeof(virtq_used_t) + size * sizeof(virtq_used_elem_t) + 2;
+    unsigned int total = used_offset + ((used_bytes + VIRTQ_ALIGN - 1) & ~(VIRTQ_ALIGN - 1));
+
+    unsigned char* memory = (unsigned char*)kmalloc_aligned(total, VIRTQ_ALIGN);
+    blk->reqs = (virtio_blk_req_t*)kmalloc(size * sizeof(virtio_blk_req_t));
+    if (memory == NULL || blk->reqs == NULL) {
+        kfree(memory);
+        kfree(blk->reqs);
+        return -1;
+    }
+    memset(memory, 0, total);
+
+    blk->queue_size = size;
+    blk->desc = (virtq_desc_t*)memory;
+    blk->avail = (virtq_avail_t*)(memory + size * sizeof(virtq_desc_t));
+    blk->used = (virtq_used_t*)(memory + used_offset);
+    blk->avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+    blk->next_desc = 0;
+    blk->avail_index = 0;
+    blk->used_index = 0;
+
+    outl(blk->io + VIRTIO_REG_QUEUE_ADDRESS, (unsigned int)((unsigned long)memory / VIRTQ_ALIGN));
+    return 0;
+}
+
+/**
+ * Bring up one virtio-blk function
+ *
+ * @param pci: PCI function
+ * @param blk: Disk state to fill in
+ * @return: 0 on success, -1 on error
+ */
+static int virtio_blk_probe(pci_device_t* pci, virtio_blk_t* blk)
+{
+    unsigned int bar0 = pci_read_bar(pci, 0);
+    if (!(bar0 & 1)) {
+        return -1;  // Legacy interface lives in I/O space
+    }
+
+    blk->io = bar0 & 0xFFFC;
+    pci_enable_bus_master(pci);
+
+    // Reset, then announce ourselves
+    outb(blk->io + VIRTIO_REG_DEVICE_STATUS, 0);
+    outb(blk->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(blk->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    unsigned int offered = inl(blk->io + VIRTIO_REG_DEVICE_FEATURES);
+    blk->features = offered & (VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_FLUSH);
+    outl(blk->io + VIRTIO_REG_GUEST_FEATURES, blk->features);
+
+    // Device limits; keep descriptors whole blocks so requests stay sector aligned
+    unsigned short config = blk->io + VIRTIO_REG_CONFIG;
+    blk->size_max = 0x80000000u;
+    if (blk->features & VIRTIO_BLK_F_SIZE_MAX) {
+        blk->size_max = inl(config + VIRTIO_BLK_CFG_SIZE_MAX);
+    }
+    blk->size_max &= ~(BLOCK_SIZE - 1);
+    if (blk->size_max == 0) {
+        blk->size_max = BLOCK_SIZE;
+    }
+    blk->seg_max = 0xFFFFFFFFu;
+    if (blk->features & VIRTIO_BLK_F_SEG_MAX) {
+        blk->seg_max = inl(config + VIRTIO_BLK_CFG_SEG_MAX);
+    }
+    if (blk->seg_max == 0) {
+        blk->seg_max = 1;
+    }
+
+    // The block layer addresses 32-bit block numbers
+    unsigned int capacity_lo = inl(config + VIRTIO_BLK_CFG_CAPACITY);
+    unsigned int capacity_hi = inl(config + VIRTIO_BLK_CFG_CAPACITY + 4);
+    blk->capacity = capacity_hi ? 0xFFFFFFFFu : capacity_lo;
+
+    if (blk->capacity == 0 || virtio_blk_setup_queue(blk) != 0) {
+        outb(blk->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    outb(blk->io + VIRTIO_REG_DEVICE_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+    return 0;
+}
+
+/**
+ * Initialize virtio block disks
+ *
+ * @return: Number of disks registered
+ */
+int virtio_blk_init(void)
+{
+    if (g_virtio_disk_count > 0) {
+        return g_virtio_disk_count;  // Already initialized
+    }
+
+    pci_device_t pci;
+    for (int index = 0; g_virtio_disk_count < VIRTIO_BLK_MAX_DISKS; index++) {
+        if (pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, index, &pci) != 0) {
+            break;
+        }
+
+        virtio_blk_t* blk = &g_virtio_disks[g_virtio_disk_count];
+        if (virtio_blk_probe(&pci, blk) != 0) {
+            continue;
+        }
+
+        blk->device = block_register(&virtio_blk_driver, blk, blk->capacity);
+        if (blk->device < 0) {
+            outb(blk->io + VIRTIO_REG_DEVICE_STATUS, 0);  // Reset: stop using the queue
+            break;
+        }
+        g_virtio_disk_count++;
+    }
+
+    return g_virtio_disk_count;
+}